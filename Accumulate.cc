@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+	Accumulating at Memory Speed
+	-------------------------------------
+	accumulate(first, last, s, op) of Tutorial_2.cc is one
+	dependency chain: s = op(s, *first) can't start before
+	the previous op has finished. A floating-point add takes
+	about four cycles, so the loop does one element per four
+	cycles, however many adders the core has.
+
+	When op is associative the elements can be grouped any
+	way we like. The contiguous version below keeps four
+	vector accumulators of 32 bytes each (16 doubles, 32
+	floats) and feeds them from consecutive loads: sixteen
+	independent chains with four vector operations in
+	flight, enough to keep up with memory on arrays that
+	don't fit in cache. (Without AVX: eight accumulators
+	of 16 bytes.)
+
+	The fast path is chosen by overload resolution:
+
+	- the iterators are contiguous (pointers, vector and
+	  array iterators), so the data can be loaded as vectors;
+	- the element type is arithmetic and the same as the
+	  accumulator type;
+	- op is std::plus, std::multiplies, Min or Max.
+
+	Everything else (lists, input iterators, user-defined
+	operations) takes the generic loop.
+
+	For floating-point plus and multiplies the grouping
+	changes the rounding, so the result can differ from the
+	left-to-right loop in the last bits. It is the same for
+	the same input, since the grouping depends only on the
+	length.
+
+	The vectors are GCC/Clang vector extensions as wide as
+	the target's (16 bytes, 32 with AVX), which compile to
+	SSE, AVX or NEON. Other compilers get the same grouping
+	in scalar accumulators.
+
+	Calls with standard-library iterators are written
+	::accumulate, or argument-dependent lookup also finds
+	std::accumulate.
+*/
+
+// The generic loop, as in Tutorial_2.cc
+template<typename Iter, typename Val, typename Oper>
+Val accumulate(Iter first, Iter last, Val s, Oper op)
+{
+	while (first != last) {
+		s = op(s, *first);
+		++first;
+	}
+	return s;
+}
+
+// std::min and std::max as operations for accumulate()
+struct Min {
+	template<typename T>
+	T operator()(const T& a, const T& b) const { return b < a ? b : a; }
+};
+
+struct Max {
+	template<typename T>
+	T operator()(const T& a, const T& b) const { return a < b ? b : a; }
+};
+
+template<typename T>
+concept simd_element = std::is_arithmetic_v<T> && !std::same_as<T, bool> && sizeof(T) <= 8;
+
+// Associative operations the vector kernel knows how to apply
+template<typename Oper, typename T>
+concept simd_op = std::same_as<Oper, std::plus<T>> || std::same_as<Oper, std::plus<>>
+	|| std::same_as<Oper, std::multiplies<T>> || std::same_as<Oper, std::multiplies<>>
+	|| std::same_as<Oper, Min> || std::same_as<Oper, Max>;
+
+// The same operation, applicable to vectors as well as to T
+template<typename T, typename Oper>
+auto lane_op(Oper op)
+{
+	if constexpr (std::same_as<Oper, std::plus<T>>)
+		return std::plus<>{};
+	else if constexpr (std::same_as<Oper, std::multiplies<T>>)
+		return std::multiplies<>{};
+	else
+		return op;
+}
+
+// The target's vector width; 128 bytes of accumulators in flight
+#if defined(__AVX__)
+constexpr std::size_t simd_bytes = 32;
+#else
+constexpr std::size_t simd_bytes = 16;
+#endif
+
+template<typename T, typename Oper>
+T reduce_contiguous(const T* p, std::size_t n, T s, Oper op)
+{
+	constexpr std::size_t lanes = simd_bytes / sizeof(T);
+	constexpr std::size_t accs = 128 / simd_bytes;
+	constexpr std::size_t step = lanes * accs;
+	auto f = lane_op<T>(op);
+	std::size_t i = 0;
+	if (n >= step) {
+#if defined(__GNUC__)
+		typedef T V __attribute__((vector_size(simd_bytes)));
+		V a[accs];
+		std::memcpy(a, p, sizeof a);
+		for (i = step; i + step <= n; i += step) {
+			V x[accs];
+			std::memcpy(x, p + i, sizeof x);
+			for (std::size_t k = 0; k < accs; ++k)
+				a[k] = f(a[k], x[k]);
+		}
+		for (std::size_t w = accs / 2; w > 0; w /= 2)
+			for (std::size_t k = 0; k < w; ++k)
+				a[k] = f(a[k], a[k + w]);
+		T r = a[0][0];
+		for (std::size_t l = 1; l < lanes; ++l)
+			r = f(r, T(a[0][l]));
+#else
+		T a[accs][lanes];
+		std::memcpy(a, p, sizeof a);
+		for (i = step; i + step <= n; i += step)
+			for (std::size_t k = 0; k < accs; ++k)
+				for (std::size_t l = 0; l < lanes; ++l)
+					a[k][l] = f(a[k][l], p[i + k * lanes + l]);
+		for (std::size_t w = accs / 2; w > 0; w /= 2)
+			for (std::size_t k = 0; k < w; ++k)
+				for (std::size_t l = 0; l < lanes; ++l)
+					a[k][l] = f(a[k][l], a[k + w][l]);
+		T r = a[0][0];
+		for (std::size_t l = 1; l < lanes; ++l)
+			r = f(r, a[0][l]);
+#endif
+		s = f(s, r);
+	}
+	for (; i < n; ++i)
+		s = f(s, p[i]);
+	return s;
+}
+
+template<std::contiguous_iterator Iter, typename Val, typename Oper>
+requires simd_element<Val> && std::same_as<std::iter_value_t<Iter>, Val> && simd_op<Oper, Val>
+Val accumulate(Iter first, Iter last, Val s, Oper op)
+{
+	return reduce_contiguous(std::to_address(first), std::size_t(last - first), s, op);
+}
+
+template<typename Iter, typename Val>
+Val accumulate(Iter first, Iter last, Val s)
+{
+	return ::accumulate(first, last, s, std::plus<>{});
+}
+
+template<typename Iter, typename Val = std::iter_value_t<Iter>>
+Val sum(Iter first, Iter last)
+{
+	return ::accumulate(first, last, Val{});
+}
+
+double add_all(double* array, int n)
+{
+	return sum(array, array + n);
+}
+
+/*
+	Parallel, Reproducible Accumulate
+	-------------------------------------
+	Splitting a sum over threads regroups it, and a
+	floating-point sum depends on the grouping: std::reduce
+	with an execution policy can give a different last bit
+	on 4 cores than on 8, or from run to run.
+
+	accumulate(first, last, s, op, pool) fixes the grouping
+	by the input alone:
+
+	1. The range is cut into blocks of reduce_block
+	   elements, whatever the number of threads.
+	2. Each block is accumulated on its own, starting from
+	   its first element (the first block from s); the
+	   threads only decide who computes which block.
+	3. The block results are combined in a fixed pairwise
+	   tree: neighbours, then neighbours of the pairs, and
+	   so on.
+
+	So the result is bit-identical for 1, 2 or 64 threads,
+	and from run to run. Blocks use the vector kernel above
+	when it applies. op must be associative on Val (up to
+	rounding) and Val constructible from an element.
+*/
+constexpr std::size_t reduce_block = 1 << 14;
+
+template<std::random_access_iterator Iter, typename Val, typename Oper>
+requires std::constructible_from<Val, std::iter_reference_t<Iter>> && std::invocable<Oper&, Val, Val>
+Val accumulate(Iter first, Iter last, Val s, Oper op, Thread_pool& pool)
+{
+	const std::size_t n = std::size_t(last - first);
+	if (n == 0) return s;
+	const std::size_t blocks = (n + reduce_block - 1) / reduce_block;
+	std::vector<Val> part(blocks, s);
+	parallel_for(pool, blocks, 4, [&](std::size_t b, std::size_t e) {
+		for (; b < e; ++b) {
+			Iter bf = first + b * reduce_block;
+			Iter bl = first + std::min(n, (b + 1) * reduce_block);
+			part[b] = b == 0 ? ::accumulate(bf, bl, s, op) : ::accumulate(bf + 1, bl, Val(*bf), op);
+		}
+	});
+	for (std::size_t w = 1; w < blocks; w *= 2)
+		for (std::size_t i = 0; i + w < blocks; i += 2 * w)
+			part[i] = op(part[i], part[i + w]);
+	return part[0];
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<typename T, typename Oper>
+void bench(const char* name, const std::vector<T>& v, T init, Oper op, int passes)
+{
+	auto serial = [op](T a, T b) { return op(a, b); };	// not a simd_op: the generic loop
+	T r1 = init, r2 = init;
+	double t1 = time_ms([&] { for (int k = 0; k < passes; ++k) r1 = accumulate(v.data(), v.data() + v.size(), init, serial); });
+	double t2 = time_ms([&] { for (int k = 0; k < passes; ++k) r2 = accumulate(v.data(), v.data() + v.size(), init, op); });
+	double bytes = double(v.size()) * sizeof(T) * passes;
+	std::printf("%-18s serial %7.2f GB/s   vector %7.2f GB/s   %5.2fx   (%g vs %g)\n",
+		name, bytes / t1 / 1e6, bytes / t2 / 1e6, t1 / t2, double(r1), double(r2));
+}
+
+int main(int argc, char* argv[])
+{
+	double a[] = {1, 2, 3, 4};
+	std::list<double> l(a, a + 4);	// not contiguous: the generic loop
+	std::printf("%g %g %g %g %g\n", add_all(a, 4), accumulate(a, a + 4, 1.0, std::multiplies<double>{}),
+		accumulate(a, a + 4, a[0], Min{}), accumulate(a, a + 4, a[0], Max{}), ::sum(l.begin(), l.end()));
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8'000'000;
+	std::mt19937_64 rng{4};
+	std::uniform_real_distribution<double> u{-1, 1};
+	std::vector<double> d(n), near_one(n);
+	std::vector<float> f(n);
+	std::vector<int> ints(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		d[i] = u(rng);
+		near_one[i] = 1 + u(rng) * 1e-9;
+		f[i] = float(u(rng));
+		ints[i] = int(rng() % 1000);
+	}
+
+	std::printf("%zu elements (out of cache)\n", n);
+	bench("double plus", d, 0.0, std::plus<double>{}, 10);
+	bench("double multiplies", near_one, 1.0, std::multiplies<double>{}, 10);
+	bench("double min", d, d[0], Min{}, 10);
+	bench("double max", d, d[0], Max{}, 10);
+	bench("float plus", f, 0.0f, std::plus<float>{}, 10);
+	bench("int plus", ints, 0, std::plus<int>{}, 10);
+
+	std::vector<double> small(d.begin(), d.begin() + std::min<std::size_t>(n, 4096));
+	std::printf("%zu elements (in cache)\n", small.size());
+	bench("double plus", small, 0.0, std::plus<double>{}, 20000);
+	bench("double min", small, small[0], Min{}, 20000);
+
+	// Scaling, and the same bits for every thread count
+	const unsigned max_threads = argc > 2 ? unsigned(std::atoi(argv[2]))
+		: std::max(1u, std::thread::hardware_concurrency());
+	auto slow_plus = [](double x, double y) { return x + y; };	// the generic loop: compute bound
+	std::printf("threads  plus ms  speedup  generic ms  speedup  result\n");
+	double t1_plus = 0, t1_slow = 0;
+	for (unsigned t = 1; t <= max_threads; t *= 2) {
+		Thread_pool pool{t};
+		double r = 0, r2 = 0;
+		double t_plus = time_ms([&] { for (int k = 0; k < 10; ++k) r = accumulate(d.begin(), d.end(), 0.0, std::plus<>{}, pool); });
+		double t_slow = time_ms([&] { for (int k = 0; k < 10; ++k) r2 = accumulate(d.begin(), d.end(), 0.0, slow_plus, pool); });
+		if (t == 1) {
+			t1_plus = t_plus;
+			t1_slow = t_slow;
+		}
+		std::printf("%7u  %7.1f  %7.2f  %10.1f  %7.2f  %a %a\n",
+			t, t_plus, t1_plus / t_plus, t_slow, t1_slow / t_slow, r, r2);
+	}
+	std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+}
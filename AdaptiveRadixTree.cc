@@ -0,0 +1,529 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+	Adaptive Radix Tree (ART)
+	-------------------------------------
+	A comparison based set (make_set in
+	TransparentLambdaComparators.cc) finds a key with
+	O(log n) full string comparisons. A radix tree
+	instead consumes the key one byte per level, so a
+	lookup costs O(key length), whatever the size of
+	the set, and all keys sharing a prefix sit in one
+	subtree. Autocomplete ("all names starting with
+	'Kow'") is a walk down the prefix followed by an
+	ordered visit of that subtree.
+
+	ART makes radix trees compact:
+
+	1. Adaptive nodes: a node grows through 4, 16, 48 and
+	   256 children, so sparse levels stay small.
+	2. Path compression: a chain of single-child nodes is
+	   stored as a prefix string in one node.
+	3. Lazy expansion: a subtree holding one key is just
+	   that key's leaf.
+
+	The 16-way node compares the byte against all its keys
+	at once with SSE2 when available.
+
+	Children are visited in unsigned byte order, which is
+	the order std::string's operator< uses, so ordered
+	iteration matches the comparator-based set.
+
+	The key is a projection Type -> std::string_view, as
+	in PrefixKeySets.cc; the leaf stores the Type itself.
+*/
+
+struct Person {
+	std::string name;
+};
+
+template<typename Type, typename Key>
+class Art_index {
+	enum Kind : std::uint8_t { leaf, n4, n16, n48, n256 };
+
+	struct Node {
+		Kind kind;
+	};
+
+	struct Leaf : Node {
+		Type value;
+		Leaf(Type v) : Node{leaf}, value{std::move(v)} {}
+	};
+
+	struct Inner : Node {
+		std::uint16_t count = 0;
+		std::string prefix;	// path compression
+		Leaf* term = nullptr;	// key ending exactly here
+	};
+
+	struct Node4 : Inner {
+		unsigned char keys[4];
+		Node* child[4];
+		Node4() { this->kind = n4; }
+	};
+
+	struct Node16 : Inner {
+		alignas(16) unsigned char keys[16];
+		Node* child[16];
+		Node16() { this->kind = n16; }
+	};
+
+	struct Node48 : Inner {
+		unsigned char index[256] = {};	// slot + 1, 0 = empty
+		Node* child[48];
+		Node48() { this->kind = n48; }
+	};
+
+	struct Node256 : Inner {
+		Node* child[256] = {};
+		Node256() { this->kind = n256; }
+	};
+
+public:
+	explicit Art_index(Key k) : key{std::move(k)} {}
+	Art_index(const Art_index&) = delete;
+	Art_index& operator=(const Art_index&) = delete;
+	~Art_index() { destroy(root); }
+
+	std::size_t size() const { return count; }
+
+	bool insert(Type v)
+	{
+		Leaf* l = new Leaf{std::move(v)};
+		if (insert(root, l, key(l->value), 0)) {
+			++count;
+			return true;
+		}
+		delete l;
+		return false;
+	}
+
+	const Type* find(std::string_view k) const
+	{
+		const Node* p = root;
+		std::size_t depth = 0;
+		while (p) {
+			if (p->kind == leaf) {
+				const Leaf* l = static_cast<const Leaf*>(p);
+				return key(l->value) == k ? &l->value : nullptr;
+			}
+			const Inner* in = static_cast<const Inner*>(p);
+			if (k.substr(depth, in->prefix.size()) != in->prefix) return nullptr;
+			depth += in->prefix.size();
+			if (depth == k.size()) return in->term ? &in->term->value : nullptr;
+			Node* const* c = find_child(in, k[depth]);
+			p = c ? *c : nullptr;
+			++depth;
+		}
+		return nullptr;
+	}
+
+	bool contains(std::string_view k) const { return find(k) != nullptr; }
+
+	// Visits every element in key order
+	template<typename F>
+	void for_each(F f) const { visit(root, f); }
+
+	/*
+		Visits, in key order, the elements whose key starts
+		with prefix; f returns false to stop (autocomplete
+		wants the first few).
+	*/
+	template<typename F>
+	void prefix_scan(std::string_view prefix, F f) const
+	{
+		const Node* p = root;
+		std::size_t depth = 0;
+		while (p) {
+			if (p->kind == leaf) {
+				const Leaf* l = static_cast<const Leaf*>(p);
+				if (key(l->value).starts_with(prefix)) f(l->value);
+				return;
+			}
+			const Inner* in = static_cast<const Inner*>(p);
+			std::string_view rest = prefix.substr(depth);
+			std::size_t n = std::min(rest.size(), in->prefix.size());
+			if (rest.substr(0, n) != std::string_view{in->prefix}.substr(0, n)) return;
+			if (rest.size() <= in->prefix.size()) {
+				visit(p, f);
+				return;
+			}
+			depth += in->prefix.size();
+			Node* const* c = find_child(in, prefix[depth]);
+			p = c ? *c : nullptr;
+			++depth;
+		}
+	}
+
+private:
+	Key key;
+	Node* root = nullptr;
+	std::size_t count = 0;
+
+	static Node* const* find_child(const Inner* in, char ch)
+	{
+		unsigned char c = ch;
+		switch (in->kind) {
+		case n4: {
+			auto* n = static_cast<const Node4*>(in);
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c) return &n->child[i];
+			return nullptr;
+		}
+		case n16: {
+			auto* n = static_cast<const Node16*>(in);
+#if defined(__SSE2__)
+			__m128i hit = _mm_cmpeq_epi8(_mm_set1_epi8(char(c)),
+				_mm_load_si128(reinterpret_cast<const __m128i*>(n->keys)));
+			unsigned mask = unsigned(_mm_movemask_epi8(hit)) & ((1u << n->count) - 1);
+			return mask ? &n->child[__builtin_ctz(mask)] : nullptr;
+#else
+			for (int i = 0; i < n->count; ++i)
+				if (n->keys[i] == c) return &n->child[i];
+			return nullptr;
+#endif
+		}
+		case n48: {
+			auto* n = static_cast<const Node48*>(in);
+			return n->index[c] ? &n->child[n->index[c] - 1] : nullptr;
+		}
+		case n256: {
+			auto* n = static_cast<const Node256*>(in);
+			return n->child[c] ? &n->child[c] : nullptr;
+		}
+		default:
+			return nullptr;
+		}
+	}
+
+	static Node** find_child(Inner* in, char c)
+	{
+		return const_cast<Node**>(find_child(static_cast<const Inner*>(in), c));
+	}
+
+	// Sorted insert into a Node4/Node16
+	template<typename N>
+	static void add_sorted(N* n, unsigned char c, Node* child)
+	{
+		int i = 0;
+		while (i < n->count && n->keys[i] < c) ++i;
+		std::memmove(n->keys + i + 1, n->keys + i, n->count - i);
+		std::memmove(n->child + i + 1, n->child + i, (n->count - i) * sizeof(Node*));
+		n->keys[i] = c;
+		n->child[i] = child;
+		++n->count;
+	}
+
+	template<typename To, typename From>
+	static To* grow_common(From* from)
+	{
+		To* to = new To;
+		to->prefix = std::move(from->prefix);
+		to->term = from->term;
+		return to;
+	}
+
+	static void add_child(Node*& ref, char ch, Node* child)
+	{
+		unsigned char c = ch;
+		Inner* in = static_cast<Inner*>(ref);
+		switch (in->kind) {
+		case n4: {
+			auto* n = static_cast<Node4*>(in);
+			if (n->count < 4) { add_sorted(n, c, child); return; }
+			Node16* g = grow_common<Node16>(n);
+			std::memcpy(g->keys, n->keys, 4);
+			std::copy(n->child, n->child + 4, g->child);
+			g->count = 4;
+			add_sorted(g, c, child);
+			delete n;
+			ref = g;
+			return;
+		}
+		case n16: {
+			auto* n = static_cast<Node16*>(in);
+			if (n->count < 16) { add_sorted(n, c, child); return; }
+			Node48* g = grow_common<Node48>(n);
+			for (int i = 0; i < 16; ++i) {
+				g->index[n->keys[i]] = std::uint8_t(i + 1);
+				g->child[i] = n->child[i];
+			}
+			g->count = 16;
+			delete n;
+			ref = g;
+			add_child(ref, ch, child);
+			return;
+		}
+		case n48: {
+			auto* n = static_cast<Node48*>(in);
+			if (n->count < 48) {
+				n->child[n->count] = child;
+				n->index[c] = std::uint8_t(++n->count);
+				return;
+			}
+			Node256* g = grow_common<Node256>(n);
+			for (int b = 0; b < 256; ++b)
+				if (n->index[b]) g->child[b] = n->child[n->index[b] - 1];
+			g->count = 48;
+			delete n;
+			ref = g;
+			add_child(ref, ch, child);
+			return;
+		}
+		case n256: {
+			auto* n = static_cast<Node256*>(in);
+			n->child[c] = child;
+			++n->count;
+			return;
+		}
+		default:
+			return;
+		}
+	}
+
+	// Puts leaf l (whose key is k) below the fresh node n at depth
+	static void place(Node4* n, Leaf* l, std::string_view k, std::size_t depth)
+	{
+		if (k.size() == depth) n->term = l;
+		else add_sorted(n, k[depth], l);
+	}
+
+	bool insert(Node*& ref, Leaf* l, std::string_view k, std::size_t depth)
+	{
+		if (!ref) {
+			ref = l;
+			return true;
+		}
+		if (ref->kind == leaf) {
+			Leaf* old = static_cast<Leaf*>(ref);
+			std::string_view ok = key(old->value);
+			if (ok == k) return false;
+			// Lazy expansion ends: split into a node holding both
+			std::size_t common = std::mismatch(k.begin() + depth, k.end(),
+				ok.begin() + depth, ok.end()).first - (k.begin() + depth);
+			Node4* n = new Node4;
+			n->prefix = std::string{k.substr(depth, common)};
+			place(n, old, ok, depth + common);
+			place(n, l, k, depth + common);
+			ref = n;
+			return true;
+		}
+
+		Inner* in = static_cast<Inner*>(ref);
+		std::string_view rest = k.substr(depth);
+		std::size_t p = std::mismatch(in->prefix.begin(), in->prefix.end(),
+			rest.begin(), rest.end()).first - in->prefix.begin();
+		if (p < in->prefix.size()) {
+			// The compressed path diverges: split it at p
+			Node4* n = new Node4;
+			n->prefix = in->prefix.substr(0, p);
+			unsigned char c = in->prefix[p];
+			in->prefix.erase(0, p + 1);
+			add_sorted(n, c, in);
+			place(n, l, k, depth + p);
+			ref = n;
+			return true;
+		}
+
+		depth += in->prefix.size();
+		if (depth == k.size()) {
+			if (in->term) return false;
+			in->term = l;
+			return true;
+		}
+		if (Node** c = find_child(in, k[depth]))
+			return insert(*c, l, k, depth + 1);
+		add_child(ref, k[depth], l);
+		return true;
+	}
+
+	template<typename F>
+	static bool call(F& f, const Type& v)
+	{
+		if constexpr (std::is_same_v<decltype(f(v)), void>) {
+			f(v);
+			return true;
+		}
+		else {
+			return f(v);
+		}
+	}
+
+	// Returns false once f asked to stop
+	template<typename F>
+	static bool visit(const Node* p, F& f)
+	{
+		if (!p) return true;
+		if (p->kind == leaf) return call(f, static_cast<const Leaf*>(p)->value);
+		const Inner* in = static_cast<const Inner*>(p);
+		if (in->term && !call(f, in->term->value)) return false;
+		switch (in->kind) {
+		case n4: {
+			auto* n = static_cast<const Node4*>(in);
+			for (int i = 0; i < n->count; ++i)
+				if (!visit(n->child[i], f)) return false;
+			return true;
+		}
+		case n16: {
+			auto* n = static_cast<const Node16*>(in);
+			for (int i = 0; i < n->count; ++i)
+				if (!visit(n->child[i], f)) return false;
+			return true;
+		}
+		case n48: {
+			auto* n = static_cast<const Node48*>(in);
+			for (int b = 0; b < 256; ++b)
+				if (n->index[b] && !visit(n->child[n->index[b] - 1], f)) return false;
+			return true;
+		}
+		case n256: {
+			auto* n = static_cast<const Node256*>(in);
+			for (int b = 0; b < 256; ++b)
+				if (!visit(n->child[b], f)) return false;
+			return true;
+		}
+		default:
+			return true;
+		}
+	}
+
+	static void destroy(Node* p)
+	{
+		if (!p) return;
+		switch (p->kind) {
+		case leaf:
+			delete static_cast<Leaf*>(p);
+			return;
+		case n4: {
+			auto* n = static_cast<Node4*>(p);
+			for (int i = 0; i < n->count; ++i) destroy(n->child[i]);
+			delete n->term;
+			delete n;
+			return;
+		}
+		case n16: {
+			auto* n = static_cast<Node16*>(p);
+			for (int i = 0; i < n->count; ++i) destroy(n->child[i]);
+			delete n->term;
+			delete n;
+			return;
+		}
+		case n48: {
+			auto* n = static_cast<Node48*>(p);
+			for (int i = 0; i < n->count; ++i) destroy(n->child[i]);
+			delete n->term;
+			delete n;
+			return;
+		}
+		case n256: {
+			auto* n = static_cast<Node256*>(p);
+			for (Node* c : n->child) destroy(c);
+			delete n->term;
+			delete n;
+			return;
+		}
+		}
+	}
+};
+
+// Like make_set, but indexed by the bytes of a string key
+template<typename Type, typename Key>
+auto make_art_index(Key&& key)
+{
+	return Art_index<Type, std::decay_t<Key>>{std::forward<Key>(key)};
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	auto by_name = [](const Person& p) -> std::string_view { return p.name; };
+	auto index = make_art_index<Person>(by_name);
+	for (const char* s : {"Alan", "Alan Kay", "Alan Turing", "Ada", "Barbara", "Al"})
+		index.insert(Person{s});
+	index.for_each([](const Person& p) { std::printf("%s | ", p.name.c_str()); });
+	std::printf("\n");
+	index.prefix_scan("Alan", [](const Person& p) { std::printf("%s | ", p.name.c_str()); });
+	std::printf("\n%d %d\n", index.contains("Alan Kay"), index.contains("Alan K"));
+
+	/*
+		Autocomplete benchmark: the first 10 names for random
+		3-letter prefixes, red-black tree lower_bound + walk
+		vs ART prefix scan.
+	*/
+	const int n = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	const int queries = argc > 2 ? std::atoi(argv[2]) : 200'000;
+	std::mt19937 rng{11};
+	std::uniform_int_distribution<int> letter{0, 25};
+	std::geometric_distribution<int> len{0.2};
+	auto word = [&](int min) {
+		std::string w(1, char('A' + letter(rng)));
+		for (int i = 0, l = min + len(rng); i < l; ++i) w += char('a' + letter(rng) % 16);
+		return w;
+	};
+	std::vector<std::string> names;
+	for (int i = 0; i < n; ++i) names.push_back(word(2) + " " + word(3));
+
+	struct Compare {
+		using is_transparent = int;
+		bool operator()(const Person& a, const Person& b) const { return a.name < b.name; }
+		bool operator()(std::string_view a, const Person& b) const { return a < b.name; }
+		bool operator()(const Person& a, std::string_view b) const { return a.name < b; }
+	};
+	std::set<Person, Compare> rb;
+	auto art = make_art_index<Person>(by_name);
+	double t_rb_build = time_ms([&] { for (auto& s : names) rb.insert(Person{s}); });
+	double t_art_build = time_ms([&] { for (auto& s : names) art.insert(Person{s}); });
+
+	std::vector<std::string> prefixes;
+	for (int i = 0; i < queries; ++i) prefixes.push_back(names[rng() % n].substr(0, 3));
+
+	std::size_t r1 = 0, r2 = 0;
+	double t_rb = time_ms([&] {
+		for (auto& q : prefixes) {
+			int k = 0;
+			for (auto it = rb.lower_bound(std::string_view{q});
+					it != rb.end() && it->name.starts_with(q) && k < 10; ++it, ++k)
+				r1 += it->name.size();
+		}
+	});
+	double t_art = time_ms([&] {
+		for (auto& q : prefixes) {
+			int k = 0;
+			art.prefix_scan(q, [&](const Person& p) {
+				r2 += p.name.size();
+				return ++k < 10;
+			});
+		}
+	});
+	std::size_t h1 = 0, h2 = 0;
+	double t_rb_find = time_ms([&] { for (auto& q : names) h1 += rb.count(std::string_view{q}); });
+	double t_art_find = time_ms([&] { for (auto& q : names) h2 += art.contains(q); });
+
+	std::printf("%d names (%zu unique)%s\n", n, art.size(),
+		r1 == r2 && h1 == h2 && rb.size() == art.size() ? "" : "  MISMATCH");
+	std::printf("build     set %8.1f ms  art %8.1f ms\n", t_rb_build, t_art_build);
+	std::printf("top-10    set %8.1f ms  art %8.1f ms  (%d prefixes)\n", t_rb, t_art, queries);
+	std::printf("lookup    set %8.1f ms  art %8.1f ms\n", t_rb_find, t_art_find);
+}
@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "FormatString.h"
+
+/*
+	Logging Without Waiting for the Disk
+	-------------------------------------
+	The variadic printf() of TemplateMetaprogramming.cc
+	formats on the caller's thread and writes to std::cout,
+	so every log line costs the caller the formatting and,
+	whenever the stream's buffer fills, a write(2) that can
+	take as long as the disk wants.
+
+	Async_logger::log(fmt, args...) does neither. The format
+	string is a Format_string (FormatString.h), checked and
+	parsed while compiling, and the call only copies, into a
+	ring owned by the calling thread:
+
+	- a pointer to the function that will format this kind
+	  of record (one per list of argument types);
+	- the Format_string itself: a pointer to the literal and
+	  its pieces, some dozens of bytes;
+	- the arguments in binary form. Numbers and pointers are
+	  copied as they are; strings (C strings, std::string,
+	  string_view) are copied as a length and the
+	  characters, since they may be gone by the time the
+	  record is formatted. Since only the text travels, a
+	  char pointer logged with %p stops compilation (at
+	  log_error_char_pointer_with_p); cast it to const
+	  void* to log the address.
+
+	Each ring has one producer (its thread) and one
+	consumer (the logger's thread), so it needs no lock:
+	the producer publishes a record by moving head with a
+	release store, the consumer frees it by moving tail. A
+	record is never split across the end of the ring; the
+	unused end is marked and skipped.
+
+	The logger's thread takes records from all the rings,
+	formats them into a 64 KB buffer and writes that to the
+	file descriptor when it fills, or when there's nothing
+	left to take. Lines from one thread come out in order;
+	lines from different threads are not ordered with one
+	another.
+
+	The caller never waits: if its ring is full (the disk
+	or the logger's thread has fallen behind by a whole
+	ring) the record is dropped, log() returns false and
+	dropped() counts it. The destructor writes everything
+	still in the rings.
+*/
+
+// Never defined: reached only while checking a log format string, as the format_error_ functions
+void log_error_char_pointer_with_p();
+
+template<typename T>
+concept char_pointer = std::same_as<std::remove_cv_t<std::decay_t<T>>, const char*>
+	|| std::same_as<std::remove_cv_t<std::decay_t<T>>, char*>;
+
+// A Format_string whose char pointers are all printed as text
+template<typename... Args>
+struct Log_format {
+	consteval Log_format(const char* s) : fmt{s}
+	{
+		// fmt has checked s, so this only needs to find the conversions
+		constexpr bool text[] = {char_pointer<Args>..., false};
+		std::size_t arg = 0;
+		for (const char* c = s; *c; ++c) {
+			if (*c != '%' || *++c == '%') continue;
+			while (*c == '.' || (*c >= '0' && *c <= '9')) ++c;
+			if (*c == 'p' && text[arg]) log_error_char_pointer_with_p();
+			++arg;
+		}
+	}
+
+	Format_string<Args...> fmt;
+};
+
+// Formats the arguments that follow a record's header
+using Record_format = std::to_chars_result (*)(const std::byte* p, char* first, char* last);
+
+struct Record {
+	std::uint32_t size;	// of the whole record, a multiple of 8; 0 marks the unused end of the ring
+	Record_format format;
+};
+
+// The bytes of one thread's records, oldest at tail
+class Log_ring {
+public:
+	Log_ring(std::size_t bytes, std::thread::id owner)
+		: owner{owner}, mask{std::bit_ceil(bytes) - 1}, data{new std::byte[mask + 1]()}	// zeroed now, so log() takes no page faults
+	{
+	}
+
+	// Room for n contiguous bytes (n a multiple of 8), or nullptr if the consumer is too far behind
+	std::byte* reserve(std::size_t n)
+	{
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		const std::size_t off = h & mask;
+		const std::size_t skip = off + n > mask + 1 ? mask + 1 - off : 0;
+		if (n > (mask + 1) / 2) return nullptr;
+		if (h + skip + n - cached_tail > mask + 1) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (h + skip + n - cached_tail > mask + 1) return nullptr;
+		}
+		if (skip) {
+			const std::uint32_t end = 0;
+			std::memcpy(data.get() + off, &end, sizeof end);
+		}
+		reserved = h + skip + n;
+		return data.get() + ((h + skip) & mask);
+	}
+
+	// Hands the bytes of the last reserve() to the consumer
+	void commit() { head.store(reserved, std::memory_order_release); }
+
+	void drop() { dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+	// Calls f(format, args) for each record published so far; false if there were none
+	template<typename F>
+	bool consume(F f)
+	{
+		std::size_t t = tail.load(std::memory_order_relaxed);
+		const std::size_t h = head.load(std::memory_order_acquire);
+		if (t == h) return false;
+		while (t != h) {
+			const std::byte* p = data.get() + (t & mask);
+			std::uint32_t size;
+			std::memcpy(&size, p, sizeof size);
+			if (size == 0) {
+				t += mask + 1 - (t & mask);
+				continue;
+			}
+			Record r;
+			std::memcpy(&r, p, sizeof r);
+			f(r.format, p + sizeof r);
+			t += size;
+		}
+		tail.store(t, std::memory_order_release);
+		return true;
+	}
+
+	const std::thread::id owner;
+	std::atomic<std::size_t> dropped{0};
+
+private:
+	// Written by the producer
+	alignas(64) std::atomic<std::size_t> head{0};
+	std::size_t cached_tail = 0;
+	std::size_t reserved = 0;
+
+	// Written by the consumer
+	alignas(64) std::atomic<std::size_t> tail{0};
+
+	alignas(64) const std::size_t mask;
+	std::unique_ptr<std::byte[]> data;
+};
+
+// How an argument travels: text as a string_view to copy, anything else as it is
+template<typename T>
+auto captured(const T& a)
+{
+	if constexpr (std::convertible_to<const T&, std::string_view>) {
+		if constexpr (std::is_pointer_v<T>)
+			if (a == nullptr) return std::string_view{"(null)"};
+		return std::string_view{a};
+	} else {
+		return a;
+	}
+}
+
+template<typename C>
+std::size_t captured_size(const C& c)
+{
+	if constexpr (std::same_as<C, std::string_view>)
+		return sizeof(std::uint32_t) + c.size();
+	else
+		return sizeof(C);
+}
+
+template<typename C>
+std::byte* write_captured(std::byte* p, const C& c)
+{
+	if constexpr (std::same_as<C, std::string_view>) {
+		const std::uint32_t n = std::uint32_t(c.size());
+		std::memcpy(p, &n, sizeof n);
+		std::memcpy(p + sizeof n, c.data(), n);
+		return p + sizeof n + n;
+	} else {
+		std::memcpy(p, &c, sizeof c);
+		return p + sizeof c;
+	}
+}
+
+template<typename C>
+C read_captured(const std::byte*& p)
+{
+	if constexpr (std::same_as<C, std::string_view>) {
+		std::uint32_t n;
+		std::memcpy(&n, p, sizeof n);
+		C c{reinterpret_cast<const char*>(p + sizeof n), n};
+		p += sizeof n + n;
+		return c;
+	} else {
+		C c;
+		std::memcpy(&c, p, sizeof c);
+		p += sizeof c;
+		return c;
+	}
+}
+
+template<typename Fmt, typename... Cs>
+std::to_chars_result format_record(const std::byte* p, char* first, char* last)
+{
+	std::array<std::byte, sizeof(Fmt)> raw;
+	std::memcpy(raw.data(), p, sizeof raw);
+	p += sizeof raw;
+	const Fmt fmt = std::bit_cast<Fmt>(raw);
+	const std::tuple<Cs...> values{read_captured<Cs>(p)...};	// braces: read in order
+	return std::apply([&](const Cs&... v) { return fmt.format(first, last, v...); }, values);
+}
+
+class Async_logger {
+public:
+	explicit Async_logger(int fd = STDOUT_FILENO, std::size_t ring_bytes = 1 << 20)
+		: fd{fd}, ring_bytes{ring_bytes}, out{new char[capacity]}
+	{
+		writer = std::thread{[this] { drain(); }};
+	}
+
+	Async_logger(const Async_logger&) = delete;
+	Async_logger& operator=(const Async_logger&) = delete;
+
+	~Async_logger()
+	{
+		done.store(true, std::memory_order_release);
+		writer.join();
+	}
+
+	// false if the record was dropped because the caller's ring is full
+	template<typename... Args>
+	bool log(Log_format<std::type_identity_t<Args>...> f, const Args&... args)
+	{
+		return put(f.fmt, captured(args)...);
+	}
+
+	// Records dropped so far, over all threads
+	std::size_t dropped() const
+	{
+		std::lock_guard lock{rings_m};
+		std::size_t n = 0;
+		for (auto& r : rings) n += r->dropped.load(std::memory_order_relaxed);
+		return n;
+	}
+
+	// false once a write has failed; later output is dropped
+	bool good() const { return ok.load(std::memory_order_relaxed); }
+
+private:
+	template<typename Fmt, typename... Cs>
+	bool put(const Fmt& fmt, const Cs&... cs)
+	{
+		static_assert(std::is_trivially_copyable_v<Fmt>);
+		const std::size_t size = (sizeof(Record) + sizeof fmt + (captured_size(cs) + ... + 0) + 7) & ~std::size_t(7);
+		Log_ring& r = ring();
+		std::byte* p = r.reserve(size);
+		if (p == nullptr) {
+			r.drop();
+			return false;
+		}
+		const Record head{std::uint32_t(size), &format_record<Fmt, Cs...>};
+		std::memcpy(p, &head, sizeof head);
+		std::memcpy(p + sizeof head, &fmt, sizeof fmt);
+		p += sizeof head + sizeof fmt;
+		((p = write_captured(p, cs)), ...);
+		r.commit();
+		return true;
+	}
+
+	// The calling thread's ring, registered on its first record
+	Log_ring& ring()
+	{
+		thread_local std::uint64_t cached_id = 0;
+		thread_local Log_ring* cached = nullptr;
+		if (cached_id != id) {
+			cached = &find_ring();
+			cached_id = id;
+		}
+		return *cached;
+	}
+
+	Log_ring& find_ring()
+	{
+		std::lock_guard lock{rings_m};
+		const auto me = std::this_thread::get_id();
+		for (auto& r : rings)
+			if (r->owner == me) return *r;
+		rings.push_back(std::make_unique<Log_ring>(ring_bytes, me));
+		return *rings.back();
+	}
+
+	// The logger's thread
+	void drain()
+	{
+		std::vector<Log_ring*> seen;
+		auto line = [this](Record_format f, const std::byte* args) {
+			auto r = f(args, out.get() + used, out.get() + capacity);
+			if (r.ec != std::errc{}) {
+				flush();
+				r = f(args, out.get(), out.get() + capacity);	// a longer line is cut
+			}
+			used = std::size_t(r.ptr - out.get());
+		};
+		for (;;) {
+			const bool stop = done.load(std::memory_order_acquire);
+			{
+				std::lock_guard lock{rings_m};
+				for (std::size_t i = seen.size(); i < rings.size(); ++i)
+					seen.push_back(rings[i].get());
+			}
+			bool any = false;
+			for (Log_ring* r : seen)
+				any |= r->consume(line);
+			if (!any) {
+				flush();
+				if (stop) return;
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+		}
+	}
+
+	// As Fd_sink::write in BufferedPrint.cc
+	void flush()
+	{
+		const char* p = out.get();
+		std::size_t n = used;
+		while (n > 0 && ok.load(std::memory_order_relaxed)) {
+			ssize_t w = ::write(fd, p, n);
+			if (w < 0) {
+				if (errno != EINTR) ok.store(false, std::memory_order_relaxed);
+				continue;
+			}
+			p += w;
+			n -= std::size_t(w);
+		}
+		used = 0;
+	}
+
+	static inline std::atomic<std::uint64_t> next_id{1};
+	static constexpr std::size_t capacity = 1 << 16;
+
+	const std::uint64_t id = next_id.fetch_add(1);
+	const int fd;
+	const std::size_t ring_bytes;
+	mutable std::mutex rings_m;
+	std::vector<std::unique_ptr<Log_ring>> rings;
+	std::unique_ptr<char[]> out;	// used only by the logger's thread
+	std::size_t used = 0;
+	std::atomic<bool> ok{true};
+	std::atomic<bool> done{false};
+	std::thread writer;
+};
+
+// The version in TemplateMetaprogramming.cc, on any stream (as in FormatString.cc)
+void stream_printf(std::ostream& os, const char* s)
+{
+	if (s == nullptr) return;
+	while (*s) {
+		if (*s == '%' && *++s != '%')
+			throw std::runtime_error("Invalid format: missing arguments");
+		os << *s++;
+	}
+}
+
+template<typename T, typename... Args>
+void stream_printf(std::ostream& os, const char* s, T value, Args... args)
+{
+	while (s && *s) {
+		if (*s == '%' && *++s != '%') {
+			os << value;
+			return stream_printf(os, ++s, args...);
+		}
+		os << *s++;
+	}
+	throw std::runtime_error("extra arguments provided to printf");
+}
+
+// Nanoseconds taken by each call of f(i)
+template<typename F>
+std::vector<std::uint32_t> latencies(int n, F f)
+{
+	std::vector<std::uint32_t> ns(std::size_t(n), 0);
+	volatile unsigned work = 0;
+	for (int i = 0; i < n; ++i) {
+		auto t0 = std::chrono::steady_clock::now();
+		f(i);
+		auto t1 = std::chrono::steady_clock::now();
+		ns[std::size_t(i)] = std::uint32_t(std::min<long long>(std::chrono::nanoseconds(t1 - t0).count(), UINT32_MAX));
+		for (int k = 0; k < 100; ++k) work = work + 1;	// the program's own work between log lines
+	}
+	return ns;
+}
+
+void report(const char* name, std::vector<std::uint32_t> ns)
+{
+	std::vector<std::size_t> buckets(21, 0);	// [2^(b+4), 2^(b+5)) ns, the last one open
+	for (auto x : ns)
+		++buckets[std::min<std::size_t>(std::size_t(std::max(int(std::bit_width(x)), 5) - 5), buckets.size() - 1)];
+	std::sort(ns.begin(), ns.end());
+	auto at = [&](double q) { return ns[std::min(ns.size() - 1, std::size_t(q * double(ns.size())))]; };
+	std::printf("%-14s p50 %6u  p90 %6u  p99 %6u  p99.9 %7u  max %9u ns\n", name, at(0.5), at(0.9), at(0.99), at(0.999), ns.back());
+	for (std::size_t b = 0; b < buckets.size(); ++b) {
+		if (buckets[b] == 0) continue;
+		const int bar = 1 + int(40.0 * double(buckets[b]) / double(ns.size()));
+		std::printf("    %8llu ns %s %9zu %.*s\n", 16ULL << b, b + 1 == buckets.size() ? "and up" : "      ",
+			buckets[b], bar, "########################################|");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	{
+		std::fflush(stdout);
+		Async_logger log;
+		std::string user = "alice";
+		int x = 255;
+		log.log("%d%% of %s: %x, %c, %.2f, %e, %s\n", 42, user, x, 'z', 3.14159, 1e-7, "done");
+		log.log("pointer %p, null %s, no arguments\n", static_cast<const void*>(&x), static_cast<const char*>(nullptr));
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 3; ++t)
+			threads.emplace_back([&log, t] {
+				std::string name = "worker " + std::to_string(t);
+				for (int i = 0; i < 3; ++i)
+					log.log("%s: line %d\n", name, i);
+			});
+		for (auto& t : threads) t.join();
+	}
+
+	const int lines = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	const char* path = "/api/v1/items";
+	const char* stream_file = "/tmp/async_log_stream.txt";
+	const char* stdio_file = "/tmp/async_log_stdio.txt";
+	const char* async_file = "/tmp/async_log_async.txt";
+
+	auto clock = latencies(lines, [](int) {});
+	std::ofstream os{stream_file};
+	auto stream = latencies(lines, [&](int i) {
+		stream_printf(os, "request % from % took % ms, status %\n", i, path, i * 0.001, 200);
+	});
+	os.close();
+	std::FILE* f = std::fopen(stdio_file, "w");
+	auto stdio = latencies(lines, [&](int i) {
+		std::fprintf(f, "request %d from %s took %.3f ms, status %d\n", i, path, i * 0.001, 200);
+	});
+	std::fclose(f);
+	std::size_t dropped;
+	std::vector<std::uint32_t> async;
+	int fd = ::open(async_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	{
+		Async_logger log{fd, 16 << 20};
+		log.log("%s\n", "start");	// the thread's first record sets up its ring
+		async = latencies(lines, [&](int i) {
+			log.log("request %d from %s took %.3f ms, status %d\n", i, path, i * 0.001, 200);
+		});
+		dropped = log.dropped();
+	}
+	::close(fd);
+
+	std::printf("%d lines, latency of one call (two clock reads included)\n", lines);
+	report("clock only", clock);
+	report("stream printf", stream);
+	report("fprintf", stdio);
+	report("Async_logger", async);
+	std::printf("Async_logger dropped %zu lines\n", dropped);
+	std::remove(stream_file);
+	std::remove(stdio_file);
+	std::remove(async_file);
+}
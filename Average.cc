@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/*
+	Computing the Average, Accurately and Fast
+	-------------------------------------
+	Average() of Cpp20Concepts.cc is
+
+		std::accumulate(vec.begin(), vec.end(), 0.0) / vec.size()
+
+	a single double accumulator, added to in order:
+
+	- it is slow: each addition waits for the one before
+	  it (see Accumulate.cc);
+	- it loses precision: once the running sum is large,
+	  every addition rounds away low bits of the element.
+	  The error grows with n, and cancelling values such as
+	  1e15, 1, -1e15 lose the small ones entirely. 64-bit
+	  integers lose everything beyond 53 bits on the way in.
+
+	Here Average() is still selected by the numeric concept
+	and then dispatches on the kind of number:
+
+	- floating point: Kahan-Neumaier summation. Next to the
+	  sum s, a compensation c collects the rounding error of
+	  each addition, which can be computed exactly:
+
+	      t = s + x
+	      c += |s| >= |x| ? (s - t) + x : (x - t) + s
+	      s = t
+
+	  s + c is then about as accurate as a sum carried in
+	  twice the precision, whatever n is. Eight (s, c) pairs
+	  run side by side in vector lanes (as many registers
+	  of the target's width as that takes), using Knuth's
+	  branch-free form of the error term; floats are widened
+	  to double as they are loaded.
+	- integral: an exact sum. Elements are widened to 64-bit
+	  lanes (64-bit elements are split into their high and
+	  low 32-bit halves), which can't overflow within a block
+	  of 2^24 elements; the blocks add up in a 128-bit
+	  integer (long double where there is none).
+
+	The vectors are GCC/Clang vector extensions; other
+	compilers run one lane. long double input is summed
+	the same way in long double, without vectors.
+*/
+
+// As in Cpp20Concepts.cc
+template<typename T>
+concept numeric = std::is_integral_v<T> || std::is_floating_point_v<T>;
+
+#if defined(__SIZEOF_INT128__)
+using wide_int = __int128;
+#else
+using wide_int = long double;
+#endif
+
+template<typename A>
+void neumaier_add(A& s, A& c, A x)
+{
+	A t = s + x;
+	c += std::abs(s) >= std::abs(x) ? (s - t) + x : (x - t) + s;
+	s = t;
+}
+
+// The target's vector width, as in Accumulate.cc
+#if defined(__AVX__)
+constexpr std::size_t simd_bytes = 32;
+#else
+constexpr std::size_t simd_bytes = 16;
+#endif
+
+// Eight 64-bit lanes, in as many registers as that takes
+constexpr std::size_t lanes = simd_bytes / 8;
+constexpr std::size_t regs = 8 / lanes;
+
+template<std::floating_point T>
+auto compensated_sum(const T* p, std::size_t n)
+{
+	using A = std::conditional_t<(sizeof(T) > sizeof(double)), long double, double>;
+	A s = 0, c = 0;
+	std::size_t i = 0;
+#if defined(__GNUC__)
+	if constexpr (std::same_as<A, double>) {
+		typedef double D __attribute__((vector_size(simd_bytes)));
+		D vs[regs] = {}, vc[regs] = {};
+		for (; i + 8 <= n; i += 8) {
+			double wide[8];
+			for (std::size_t l = 0; l < 8; ++l)
+				wide[l] = p[i + l];
+			for (std::size_t k = 0; k < regs; ++k) {
+				D x;
+				std::memcpy(&x, wide + k * lanes, sizeof x);
+				// Knuth's branch-free form of the same error term
+				D t = vs[k] + x;
+				D z = t - vs[k];
+				vc[k] += (vs[k] - (t - z)) + (x - z);
+				vs[k] = t;
+			}
+		}
+		for (std::size_t k = 0; k < regs; ++k)
+			for (std::size_t l = 0; l < lanes; ++l) {
+				neumaier_add(s, c, vs[k][l]);
+				c += vc[k][l];
+			}
+	}
+#endif
+	for (; i < n; ++i)
+		neumaier_add(s, c, A(p[i]));
+	// An infinity or NaN in the input leaves c NaN
+	return std::isfinite(s) ? s + c : s;
+}
+
+template<std::integral T>
+wide_int exact_sum(const T* p, std::size_t n)
+{
+	constexpr std::size_t block = std::size_t(1) << 24;
+	wide_int total = 0;
+	for (std::size_t b = 0; b < n; b += block) {
+		const std::size_t e = std::min(n, b + block);
+		std::size_t i = b;
+		std::int64_t hi = 0, lo = 0;
+#if defined(__GNUC__)
+		if constexpr (!std::same_as<T, bool>) {
+			typedef std::int64_t W __attribute__((vector_size(simd_bytes)));
+			typedef T In __attribute__((vector_size(lanes * sizeof(T))));
+			W vhi[regs] = {}, vlo[regs] = {};
+			for (; i + 8 <= e; i += 8) {
+				for (std::size_t k = 0; k < regs; ++k) {
+					In raw;
+					std::memcpy(&raw, p + i + k * lanes, sizeof raw);
+					if constexpr (sizeof(T) < 8) {
+						vlo[k] += __builtin_convertvector(raw, W);
+					} else {
+						vhi[k] += __builtin_convertvector(raw >> 32, W);
+						vlo[k] += __builtin_convertvector(raw & 0xffffffff, W);
+					}
+				}
+			}
+			for (std::size_t k = 0; k < regs; ++k)
+				for (std::size_t l = 0; l < lanes; ++l) {
+					hi += vhi[k][l];
+					lo += vlo[k][l];
+				}
+		}
+#endif
+		for (; i < e; ++i) {
+			if constexpr (sizeof(T) < 8) {
+				lo += p[i];
+			} else {
+				hi += std::int64_t(p[i] >> 32);
+				lo += std::int64_t(p[i] & 0xffffffff);
+			}
+		}
+#if defined(__SIZEOF_INT128__)
+		total += (wide_int(hi) << 32) + wide_int(lo);
+#else
+		total += wide_int(hi) * 4294967296.0L + wide_int(lo);
+#endif
+	}
+	return total;
+}
+
+template<numeric T>
+double Average(std::span<const T> vec)
+{
+	const std::size_t n = vec.size();
+	if (n == 0) return std::numeric_limits<double>::quiet_NaN();
+	if constexpr (std::floating_point<T>) {
+		return double(compensated_sum(vec.data(), n) / n);
+	} else {
+		wide_int s = exact_sum(vec.data(), n);
+#if defined(__SIZEOF_INT128__)
+		return double(s / wide_int(n)) + double(s % wide_int(n)) / double(n);
+#else
+		return double(s / n);
+#endif
+	}
+}
+
+template<numeric T>
+double Average(const std::vector<T>& vec)
+{
+	if constexpr (std::same_as<T, bool>) {
+		// vector<bool> is packed bits, not an array
+		if (vec.empty()) return std::numeric_limits<double>::quiet_NaN();
+		return double(std::count(vec.begin(), vec.end(), true)) / double(vec.size());
+	} else {
+		return Average(std::span<const T>{vec});
+	}
+}
+
+// The version in Cpp20Concepts.cc
+template<numeric T>
+double Average2(const std::vector<T>& vec)
+{
+	const double sum = std::accumulate(vec.begin(), vec.end(), 0.0);
+	return sum / static_cast<double>(vec.size());
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<typename T>
+void compare(const char* name, const std::vector<T>& v, long double exact)
+{
+	double a2 = 0, a = 0;
+	double t2 = time_ms([&] { a2 = Average2(v); });
+	double t = time_ms([&] { a = Average(v); });
+	auto rel = [&](double x) { return double(std::abs((x - exact) / exact)); };
+	std::printf("%-24s %8.1f ms %9.2e   %8.1f ms %9.2e   %5.2fx\n", name, t2, rel(a2), t, rel(a), t2 / t);
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<int> small{1, 2, 3, 4};
+	std::vector<float> fsmall{0.5f, 1.5f};
+	std::printf("%g %g\n", Average(small), Average(fsmall));
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+	std::mt19937_64 rng{8};
+	std::printf("%zu elements       Average2 (std::accumulate)      Average (this file)\n", n);
+	std::printf("%-24s %11s %9s   %11s %9s\n", "", "time", "rel. err", "time", "rel. err");
+
+	// Floats around a large mean: the running double sum swamps the noise
+	{
+		std::normal_distribution<float> dist{1e4f, 1.0f};
+		std::vector<float> v(n);
+		for (auto& x : v) x = dist(rng);
+		long double s = 0, c = 0;
+		for (float x : v) neumaier_add(s, c, (long double)x);
+		compare("float, mean 1e4", v, (s + c) / n);
+	}
+
+	// Doubles that cancel: small integers between +/- k * 2^40
+	{
+		std::vector<double> v(n);
+		wide_int exact = 0;
+		for (std::size_t i = 0; i < n; i += 2) {
+			double big = double(rng() % 1000) * 0x1p40;
+			double small_part = double(std::int64_t(rng() % 2001) - 1000);
+			v[i] = big + (i % 4 ? small_part : 0);
+			if (i + 1 < n) v[i + 1] = -big;
+			else exact += wide_int(big);
+			exact += wide_int(i % 4 ? small_part : 0);
+		}
+		std::shuffle(v.begin(), v.end(), rng);
+		compare("double, cancelling", v, (long double)exact / n);
+	}
+
+	// Integers: 32-bit for speed, 64-bit beyond double's 53 bits
+	{
+		std::vector<std::int32_t> v(n);
+		wide_int exact = 0;
+		for (auto& x : v) exact += (x = std::int32_t(rng()));
+		compare("int32", v, (long double)exact / n);
+	}
+	{
+		std::vector<std::int64_t> v(n);
+		wide_int exact = 0;
+		for (auto& x : v) exact += (x = std::int64_t(0x7ff0'0000'0000'0000 + rng() % 0x10'0000'0000'0000 - 0x8'0000'0000'0000));
+		compare("int64 near 2^63", v, (long double)exact / n);
+	}
+}
@@ -0,0 +1,631 @@
+/*
+	A Cache-Friendly Ordered Map: B+ Tree
+	-------------------------------------------
+	The map<Key,V,Compare> from Template_Specialization.cc
+	takes its ordering as a template argument. std::map
+	implements that with a red-black tree: one key per
+	node, every node a separate allocation. An ordered
+	scan is a pointer chase per element and each step
+	is likely a cache miss.
+
+	A B+ tree keeps the same interface but stores many
+	keys per node:
+
+	1. Node size is a template value argument, so a node
+	   fills a few cache lines (or a page): Node_bytes
+	   bounds sizeof a node and the key arrays get as many
+	   slots as fit. It defaults to 256 bytes, or to what
+	   four keys per node take when Key or V are large.
+	2. All values live in the leaves; leaves are linked
+	   so a range scan walks arrays, not pointers.
+	3. Inner nodes only hold separator keys and child
+	   pointers, so the tree is shallow.
+	4. A node that erase leaves under half full borrows
+	   a key from a sibling, or merges with it when both
+	   fit in one node; a root with one child goes away.
+
+	The ordering is still just a Compare argument, so
+	function objects and lambdas work exactly as with
+	map<string,int,std::greater<string>> or the cmp lambda.
+
+	Key and V must be default constructible (nodes hold
+	arrays of them).
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The size of a cache-line aligned node (more, for an
+// over-aligned field): a header, then fields of {size,
+// alignment}, padded as the compiler does
+constexpr std::size_t node_layout(std::size_t header,
+	std::initializer_list<std::pair<std::size_t, std::size_t>> fields)
+{
+	std::size_t n = header;
+	std::size_t node_align = 64;
+	for (auto [size, align] : fields) {
+		n = (n + align - 1) / align * align + size;
+		node_align = std::max(node_align, align);
+	}
+	return (n + node_align - 1) / node_align * node_align;
+}
+
+struct Btree_node {
+	bool leaf;
+	int n = 0;
+};
+
+// 256, or enough for a leaf and an inner node with four
+// keys each (and the spare slot) if that is more
+template<typename Key, typename V>
+constexpr std::size_t btree_node_bytes = std::max({std::size_t{256},
+	node_layout(sizeof(Btree_node), {{5 * sizeof(Key), alignof(Key)},
+		{5 * sizeof(V), alignof(V)}, {sizeof(void*), alignof(void*)}}),
+	node_layout(sizeof(Btree_node), {{5 * sizeof(Key), alignof(Key)},
+		{6 * sizeof(void*), alignof(void*)}})});
+
+template<typename Key, typename V,
+	typename Compare = std::less<Key>,
+	std::size_t Node_bytes = btree_node_bytes<Key, V>>
+class Btree_map {
+	using Node = Btree_node;
+
+	// A node is at most Node_bytes, header, padding, link
+	// and one spare slot included: the spare lets an insert
+	// go in first and the split happen afterwards.
+	static constexpr int leaf_cap = [] {
+		std::size_t slots = Node_bytes / sizeof(Key);
+		while (slots > 0 && node_layout(sizeof(Node), {{slots * sizeof(Key), alignof(Key)},
+				{slots * sizeof(V), alignof(V)}, {sizeof(void*), alignof(void*)}}) > Node_bytes)
+			--slots;
+		return int(slots) - 1;
+	}();
+	static constexpr int inner_cap = [] {
+		std::size_t slots = Node_bytes / sizeof(Key);
+		while (slots > 0 && node_layout(sizeof(Node), {{slots * sizeof(Key), alignof(Key)},
+				{(slots + 1) * sizeof(void*), alignof(void*)}}) > Node_bytes)
+			--slots;
+		return int(slots) - 1;
+	}();
+
+	struct alignas(64) Leaf : Node {
+		Leaf() : Node{true} {}
+		Key keys[leaf_cap + 1];
+		V vals[leaf_cap + 1];
+		Leaf* next = nullptr;
+	};
+
+	struct alignas(64) Inner : Node {
+		Inner() : Node{false} {}
+		Key keys[inner_cap + 1];
+		Node* kids[inner_cap + 2];
+	};
+
+	static_assert(leaf_cap >= 4 && inner_cap >= 4, "Node_bytes too small for four keys per node");
+	static_assert(sizeof(Leaf) <= Node_bytes && sizeof(Inner) <= Node_bytes);
+
+public:
+	using key_type = Key;
+	using mapped_type = V;
+	using key_compare = Compare;
+	using size_type = std::size_t;
+
+	// iterator, or const_iterator when Const (whose values can't be changed)
+	template<bool Const>
+	class basic_iterator {
+		friend class Btree_map;
+		template<bool> friend class basic_iterator;
+		using Value = std::conditional_t<Const, const V, V>;
+		Leaf* leaf = nullptr;
+		int i = 0;
+		basic_iterator(Leaf* l, int pos) : leaf{l}, i{pos} { skip(); }
+		void skip() { while (leaf && i == leaf->n) { leaf = leaf->next; i = 0; } }
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<const Key, V>;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::pair<const Key&, Value&>;
+
+		basic_iterator() = default;
+		template<bool C> requires (Const && !C)
+		basic_iterator(const basic_iterator<C>& o) : leaf{o.leaf}, i{o.i} {}
+		const Key& key() const { return leaf->keys[i]; }
+		Value& value() const { return leaf->vals[i]; }
+		reference operator*() const { return {leaf->keys[i], leaf->vals[i]}; }
+		basic_iterator& operator++() { ++i; skip(); return *this; }
+		basic_iterator operator++(int) { basic_iterator t = *this; ++*this; return t; }
+		bool operator==(const basic_iterator& o) const { return leaf == o.leaf && i == o.i; }
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	Btree_map() {}
+	Btree_map(Compare c) : cmp{std::move(c)} {}
+	Btree_map(const Btree_map&) = delete;
+	Btree_map& operator=(const Btree_map&) = delete;
+	Btree_map(Btree_map&& o) noexcept
+		: cmp{std::move(o.cmp)}, root{o.root}, first{o.first}, count{o.count}
+	{
+		o.root = nullptr; o.first = nullptr; o.count = 0;
+	}
+	Btree_map& operator=(Btree_map&& o) noexcept
+	{
+		if (this != &o) {
+			destroy(root);
+			cmp = std::move(o.cmp);
+			root = o.root; first = o.first; count = o.count;
+			o.root = nullptr; o.first = nullptr; o.count = 0;
+		}
+		return *this;
+	}
+	~Btree_map() { destroy(root); }
+
+	size_type size() const { return count; }
+	bool empty() const { return count == 0; }
+	iterator begin() { return iterator{first, 0}; }
+	iterator end() { return iterator{}; }
+	const_iterator begin() const { return const_iterator{first, 0}; }
+	const_iterator end() const { return const_iterator{}; }
+	const Compare& key_comp() const { return cmp; }
+
+	void clear()
+	{
+		destroy(root);
+		root = nullptr; first = nullptr; count = 0;
+	}
+
+	// Like map::insert: an existing key keeps its value.
+	std::pair<iterator, bool> insert(const Key& k, const V& v)
+	{
+		if (!root) {
+			Leaf* l = new Leaf;
+			root = first = l;
+		}
+		Key sep;
+		Node* right = nullptr;
+		iterator pos;
+		bool inserted = insert_rec(root, k, v, sep, right, pos);
+		if (right) {
+			Inner* r = new Inner;
+			r->n = 1;
+			r->keys[0] = std::move(sep);
+			r->kids[0] = root;
+			r->kids[1] = right;
+			root = r;
+		}
+		if (inserted) ++count;
+		return {pos, inserted};
+	}
+
+	V& operator[](const Key& k) { return insert(k, V{}).first.value(); }
+
+	// Like map::erase: returns the number of keys removed (0 or 1)
+	size_type erase(const Key& k)
+	{
+		if (!root || !erase_rec(root, k)) return 0;
+		--count;
+		if (!root->leaf && root->n == 0) {
+			Inner* old = static_cast<Inner*>(root);
+			root = old->kids[0];
+			delete old;
+		}
+		else if (root->leaf && root->n == 0) {
+			delete static_cast<Leaf*>(root);
+			root = nullptr; first = nullptr;
+		}
+		return 1;
+	}
+
+	// Returns an iterator to the key after the erased one
+	iterator erase(const_iterator pos)
+	{
+		Key k = pos.key();
+		erase(k);
+		return lower_bound(k);
+	}
+
+	iterator lower_bound(const Key& k) { return lower_bound_as<iterator>(k); }
+	const_iterator lower_bound(const Key& k) const { return lower_bound_as<const_iterator>(k); }
+	iterator find(const Key& k) { return find_as<iterator>(k); }
+	const_iterator find(const Key& k) const { return find_as<const_iterator>(k); }
+
+	bool contains(const Key& k) const { return find(k) != end(); }
+
+	// Calls f(key, value) for every key in [lo, hi),
+	// walking the linked leaves.
+	template<typename F>
+	void scan(const Key& lo, const Key& hi, F f) const
+	{
+		if (!root) return;
+		Leaf* l = find_leaf(lo);
+		for (int i = leaf_lower(l, lo); l; l = l->next, i = 0) {
+			for (; i < l->n; ++i) {
+				if (!cmp(l->keys[i], hi)) return;
+				f(l->keys[i], l->vals[i]);
+			}
+		}
+	}
+
+	template<typename F>
+	void scan(F f) const
+	{
+		for (Leaf* l = first; l; l = l->next)
+			for (int i = 0; i < l->n; ++i)
+				f(l->keys[i], l->vals[i]);
+	}
+
+	/*
+		Bulk loading replaces the contents with the
+		pairs in [b, e). Input already sorted (and unique)
+		under cmp is packed straight into leaves and the
+		inner levels are built bottom-up: O(n). Otherwise
+		it is sorted once first.
+	*/
+	template<typename Iter>
+	void bulk_load(Iter b, Iter e)
+	{
+		std::vector<std::pair<Key, V>> tmp;
+		auto key_less = [this](const auto& x, const auto& y) { return cmp(x.first, y.first); };
+		auto key_equal = [this](const auto& x, const auto& y) {
+			return !cmp(x.first, y.first) && !cmp(y.first, x.first);
+		};
+		bool ordered = true;
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+				typename std::iterator_traits<Iter>::iterator_category>) {
+			Iter prev = b;
+			for (Iter it = b; it != e; prev = it++)
+				if (it != b && !cmp(prev->first, it->first)) { ordered = false; break; }
+		}
+		else {
+			ordered = false;
+		}
+		if (!ordered) {
+			tmp.assign(b, e);
+			std::stable_sort(tmp.begin(), tmp.end(), key_less);
+			tmp.erase(std::unique(tmp.begin(), tmp.end(), key_equal), tmp.end());
+			build(tmp.begin(), tmp.end());
+		}
+		else {
+			build(b, e);
+		}
+	}
+
+private:
+	[[no_unique_address]] Compare cmp {};
+	Node* root = nullptr;
+	Leaf* first = nullptr;
+	size_type count = 0;
+
+	template<typename It>
+	It lower_bound_as(const Key& k) const
+	{
+		if (!root) return It{};
+		Leaf* l = find_leaf(k);
+		return It{l, leaf_lower(l, k)};
+	}
+
+	template<typename It>
+	It find_as(const Key& k) const
+	{
+		It it = lower_bound_as<It>(k);
+		if (it == It{} || cmp(k, it.key())) return It{};
+		return it;
+	}
+
+	int leaf_lower(const Leaf* l, const Key& k) const
+	{
+		return int(std::lower_bound(l->keys, l->keys + l->n, k, cmp) - l->keys);
+	}
+
+	int inner_child(const Inner* in, const Key& k) const
+	{
+		return int(std::upper_bound(in->keys, in->keys + in->n, k, cmp) - in->keys);
+	}
+
+	Leaf* find_leaf(const Key& k) const
+	{
+		Node* p = root;
+		while (!p->leaf) {
+			Inner* in = static_cast<Inner*>(p);
+			p = in->kids[inner_child(in, k)];
+		}
+		return static_cast<Leaf*>(p);
+	}
+
+	bool insert_rec(Node* p, const Key& k, const V& v,
+		Key& sep, Node*& right, iterator& pos)
+	{
+		right = nullptr;
+		if (p->leaf) {
+			Leaf* l = static_cast<Leaf*>(p);
+			int i = leaf_lower(l, k);
+			if (i < l->n && !cmp(k, l->keys[i])) {
+				pos = iterator{l, i};
+				return false;
+			}
+			std::move_backward(l->keys + i, l->keys + l->n, l->keys + l->n + 1);
+			std::move_backward(l->vals + i, l->vals + l->n, l->vals + l->n + 1);
+			l->keys[i] = k;
+			l->vals[i] = v;
+			++l->n;
+			pos = iterator{l, i};
+			if (l->n > leaf_cap) {
+				Leaf* r = new Leaf;
+				int half = l->n / 2;
+				r->n = l->n - half;
+				std::move(l->keys + half, l->keys + l->n, r->keys);
+				std::move(l->vals + half, l->vals + l->n, r->vals);
+				l->n = half;
+				r->next = l->next;
+				l->next = r;
+				if (i >= half) pos = iterator{r, i - half};
+				sep = r->keys[0];
+				right = r;
+			}
+			return true;
+		}
+
+		Inner* in = static_cast<Inner*>(p);
+		int c = inner_child(in, k);
+		Key child_sep;
+		Node* child_right = nullptr;
+		bool inserted = insert_rec(in->kids[c], k, v, child_sep, child_right, pos);
+		if (!child_right) return inserted;
+
+		std::move_backward(in->keys + c, in->keys + in->n, in->keys + in->n + 1);
+		std::move_backward(in->kids + c + 1, in->kids + in->n + 1, in->kids + in->n + 2);
+		in->keys[c] = std::move(child_sep);
+		in->kids[c + 1] = child_right;
+		++in->n;
+		if (in->n > inner_cap) {
+			Inner* r = new Inner;
+			int half = in->n / 2;
+			sep = std::move(in->keys[half]);
+			r->n = in->n - half - 1;
+			std::move(in->keys + half + 1, in->keys + in->n, r->keys);
+			std::copy(in->kids + half + 1, in->kids + in->n + 1, r->kids);
+			in->n = half;
+			right = r;
+		}
+		return inserted;
+	}
+
+	/*
+		Erase from the subtree at p. A child left under
+		half full borrows from a sibling, or merges with it
+		when both fit in one node; merges always keep the
+		left node, so the leaf links and first stay valid.
+		The caller shrinks the root.
+	*/
+	bool erase_rec(Node* p, const Key& k)
+	{
+		if (p->leaf) {
+			Leaf* l = static_cast<Leaf*>(p);
+			int i = leaf_lower(l, k);
+			if (i == l->n || cmp(k, l->keys[i])) return false;
+			std::move(l->keys + i + 1, l->keys + l->n, l->keys + i);
+			std::move(l->vals + i + 1, l->vals + l->n, l->vals + i);
+			--l->n;
+			return true;
+		}
+
+		Inner* in = static_cast<Inner*>(p);
+		int c = inner_child(in, k);
+		if (!erase_rec(in->kids[c], k)) return false;
+		Node* kid = in->kids[c];
+		if (kid->n < (kid->leaf ? leaf_cap : inner_cap) / 2) {
+			if (kid->leaf) rebalance_leaves(in, c > 0 ? c - 1 : c);
+			else rebalance_inners(in, c > 0 ? c - 1 : c);
+		}
+		return true;
+	}
+
+	// Evens out in->kids[c] and in->kids[c + 1], or merges them
+	void rebalance_leaves(Inner* in, int c)
+	{
+		Leaf* l = static_cast<Leaf*>(in->kids[c]);
+		Leaf* r = static_cast<Leaf*>(in->kids[c + 1]);
+		if (l->n + r->n <= leaf_cap) {
+			std::move(r->keys, r->keys + r->n, l->keys + l->n);
+			std::move(r->vals, r->vals + r->n, l->vals + l->n);
+			l->n += r->n;
+			l->next = r->next;
+			delete r;
+			remove_kid(in, c);
+		}
+		else if (l->n < r->n) {
+			l->keys[l->n] = std::move(r->keys[0]);
+			l->vals[l->n] = std::move(r->vals[0]);
+			++l->n;
+			std::move(r->keys + 1, r->keys + r->n, r->keys);
+			std::move(r->vals + 1, r->vals + r->n, r->vals);
+			--r->n;
+			in->keys[c] = r->keys[0];
+		}
+		else {
+			std::move_backward(r->keys, r->keys + r->n, r->keys + r->n + 1);
+			std::move_backward(r->vals, r->vals + r->n, r->vals + r->n + 1);
+			--l->n;
+			r->keys[0] = std::move(l->keys[l->n]);
+			r->vals[0] = std::move(l->vals[l->n]);
+			++r->n;
+			in->keys[c] = r->keys[0];
+		}
+	}
+
+	// As rebalance_leaves, rotating through the separator in->keys[c]
+	void rebalance_inners(Inner* in, int c)
+	{
+		Inner* l = static_cast<Inner*>(in->kids[c]);
+		Inner* r = static_cast<Inner*>(in->kids[c + 1]);
+		if (l->n + 1 + r->n <= inner_cap) {
+			l->keys[l->n] = std::move(in->keys[c]);
+			std::move(r->keys, r->keys + r->n, l->keys + l->n + 1);
+			std::copy(r->kids, r->kids + r->n + 1, l->kids + l->n + 1);
+			l->n += 1 + r->n;
+			delete r;
+			remove_kid(in, c);
+		}
+		else if (l->n < r->n) {
+			l->keys[l->n] = std::move(in->keys[c]);
+			l->kids[l->n + 1] = r->kids[0];
+			++l->n;
+			in->keys[c] = std::move(r->keys[0]);
+			std::move(r->keys + 1, r->keys + r->n, r->keys);
+			std::copy(r->kids + 1, r->kids + r->n + 1, r->kids);
+			--r->n;
+		}
+		else {
+			std::move_backward(r->keys, r->keys + r->n, r->keys + r->n + 1);
+			std::copy_backward(r->kids, r->kids + r->n + 1, r->kids + r->n + 2);
+			r->keys[0] = std::move(in->keys[c]);
+			r->kids[0] = l->kids[l->n];
+			++r->n;
+			in->keys[c] = std::move(l->keys[l->n - 1]);
+			--l->n;
+		}
+	}
+
+	// Drops the separator in->keys[c] and the child to its right
+	static void remove_kid(Inner* in, int c)
+	{
+		std::move(in->keys + c + 1, in->keys + in->n, in->keys + c);
+		std::copy(in->kids + c + 2, in->kids + in->n + 1, in->kids + c + 1);
+		--in->n;
+	}
+
+	template<typename Iter>
+	void build(Iter b, Iter e)
+	{
+		clear();
+		// Nodes are filled to capacity; the spare slot
+		// leaves room for the first insert after loading.
+		std::vector<Node*> level;
+		std::vector<Key> lows; // smallest key below each node
+		Leaf* prev = nullptr;
+		for (Iter it = b; it != e; ) {
+			Leaf* l = new Leaf;
+			for (; it != e && l->n < leaf_cap; ++it, ++l->n) {
+				l->keys[l->n] = it->first;
+				l->vals[l->n] = it->second;
+			}
+			count += l->n;
+			if (prev) prev->next = l;
+			else first = l;
+			prev = l;
+			level.push_back(l);
+			lows.push_back(l->keys[0]);
+		}
+		if (level.empty()) return;
+
+		while (level.size() > 1) {
+			std::vector<Node*> up;
+			std::vector<Key> up_lows;
+			for (std::size_t i = 0; i < level.size(); ) {
+				Inner* in = new Inner;
+				std::size_t take = std::min<std::size_t>(inner_cap + 1, level.size() - i);
+				// Don't leave a single orphan child for the last node.
+				if (level.size() - i - take == 1) --take;
+				up_lows.push_back(lows[i]);
+				in->kids[0] = level[i];
+				for (std::size_t j = 1; j < take; ++j) {
+					in->keys[j - 1] = lows[i + j];
+					in->kids[j] = level[i + j];
+				}
+				in->n = int(take - 1);
+				up.push_back(in);
+				i += take;
+			}
+			level.swap(up);
+			lows.swap(up_lows);
+		}
+		root = level[0];
+	}
+
+	static void destroy(Node* p)
+	{
+		if (!p) return;
+		if (p->leaf) {
+			delete static_cast<Leaf*>(p);
+			return;
+		}
+		Inner* in = static_cast<Inner*>(p);
+		for (int i = 0; i <= in->n; ++i)
+			destroy(in->kids[i]);
+		delete in;
+	}
+};
+
+// Passing lambdas, as with map<Key,V,Compare>
+auto cmp = [](const std::string& x, const std::string& y)
+			{ return x < y; };
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	Btree_map<std::string, int, decltype(cmp)> names{cmp};
+	for (const char* s : {"Zoe", "Adam", "Mia", "Liam", "Emma"})
+		names[s] = int(std::string{s}.size());
+	names.scan("B", "N", [](const std::string& k, int v) {
+		std::cout << k << " " << v << "\n";
+	});
+
+	Btree_map<int, int, std::greater<int>> down;
+	for (int i = 0; i < 10; ++i) down.insert(i, i * i);
+	for (auto it = down.begin(); it != down.end(); )
+		it = it.key() % 3 == 0 ? down.erase(it) : std::next(it);
+	for (auto [k, v] : down) std::cout << k << ":" << v << " ";
+	std::cout << "\n";
+
+	// Ordered scan: std::map vs B+ tree
+	const int n = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	std::vector<std::pair<long, long>> data(n);
+	for (int i = 0; i < n; ++i) data[i] = {2L * i, i};
+	std::vector<std::pair<long, long>> shuffled = data;
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64{42});
+
+	std::map<long, long> rb;
+	Btree_map<long, long> bt;
+	Btree_map<long, long> bulk;
+	double t_rb_ins = time_ms([&] { for (auto& [k, v] : shuffled) rb.emplace(k, v); });
+	double t_bt_ins = time_ms([&] { for (auto& [k, v] : shuffled) bt.insert(k, v); });
+	double t_bulk = time_ms([&] { bulk.bulk_load(data.begin(), data.end()); });
+
+	long s1 = 0, s2 = 0, s3 = 0;
+	double t_rb = time_ms([&] { for (auto& [k, v] : rb) s1 += v; });
+	double t_bt = time_ms([&] { bt.scan([&](long, long v) { s2 += v; }); });
+	double t_bk = time_ms([&] { for (auto [k, v] : bulk) s3 += v; });
+
+	std::mt19937_64 rng{7};
+	long hits = 0;
+	double t_find = time_ms([&] {
+		for (int i = 0; i < n; ++i) hits += bulk.contains(long(rng() % (2 * n)));
+	});
+
+	std::cout << "n = " << n << (s1 == s2 && s2 == s3 ? "" : "  MISMATCH") << "\n"
+		<< "insert   std::map " << t_rb_ins << " ms, btree " << t_bt_ins
+		<< " ms, bulk_load " << t_bulk << " ms\n"
+		<< "scan     std::map " << t_rb << " ms, btree " << t_bt
+		<< " ms, btree iterator " << t_bk << " ms\n"
+		<< "lookups  btree " << t_find << " ms (" << hits << " hits)\n";
+}
@@ -0,0 +1,278 @@
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <forward_list>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+/*
+	Printing Containers in Bulk
+	-------------------------------------
+	print(), print2() and print3() of Cpp20Concepts.cc send
+	every element and every separator through std::cout
+	<<: a virtual call into the stream buffer, a locale
+	lookup and, with the default sync_with_stdio, a trip
+	through stdio for each of them. Dumping 10M elements
+	makes 20M such calls.
+
+	The versions here format into an Out_buffer instead, a
+	64 KB array on the stack, and hand it to a sink one
+	full buffer at a time:
+
+	- numbers are formatted by std::to_chars, which neither
+	  allocates nor looks at the locale. Floating-point
+	  values get the format std::cout uses by default (%g
+	  with six significant digits), so the text is the same;
+	- char prints as a character and bool as 1 or 0, as
+	  with <<; strings are copied; other types fall back to
+	  their operator<< through a string stream.
+
+	A sink is anything with write(const char*, size_t):
+
+	- Fd_sink writes to a file descriptor (a file, a pipe,
+	  a socket) with write(2), retrying partial writes;
+	- Memory_sink appends to a std::string.
+
+	Without a sink the output goes to standard output, after
+	flushing stdio (and so std::cout, which is synchronized
+	with it) to keep the order of earlier output.
+
+	print3() also accepts ranges that don't know their size
+	(a std::forward_list, say): the separator is written
+	before each element after the first.
+*/
+
+template<typename S>
+concept sink = requires(S& s, const char* p, std::size_t n) {
+	s.write(p, n);
+};
+
+class Fd_sink {
+public:
+	explicit Fd_sink(int fd) : fd{fd} {}
+
+	void write(const char* p, std::size_t n)
+	{
+		while (n > 0 && ok) {
+			ssize_t w = ::write(fd, p, n);
+			if (w < 0) {
+				if (errno != EINTR) ok = false;
+				continue;
+			}
+			p += w;
+			n -= std::size_t(w);
+		}
+	}
+
+	// false once a write has failed; later output is dropped
+	bool good() const { return ok; }
+
+private:
+	int fd;
+	bool ok = true;
+};
+
+struct Memory_sink {
+	std::string text;
+
+	void write(const char* p, std::size_t n) { text.append(p, n); }
+};
+
+// Standard output, after what stdio and std::cout hold
+inline Fd_sink stdout_sink()
+{
+	std::fflush(stdout);
+	return Fd_sink{STDOUT_FILENO};
+}
+
+template<typename T>
+concept character = std::same_as<T, char> || std::same_as<T, signed char> || std::same_as<T, unsigned char>;
+
+template<sink S>
+class Out_buffer {
+public:
+	explicit Out_buffer(S& s) : out{s} {}
+	~Out_buffer() { flush(); }
+
+	Out_buffer(const Out_buffer&) = delete;
+	Out_buffer& operator=(const Out_buffer&) = delete;
+
+	void put(std::string_view s)
+	{
+		if (s.size() > capacity - used) {
+			flush();
+			if (s.size() > capacity) {
+				out.write(s.data(), s.size());
+				return;
+			}
+		}
+		std::memcpy(buf + used, s.data(), s.size());
+		used += s.size();
+	}
+
+	template<typename T>
+	requires std::is_arithmetic_v<T>
+	void put(T x)
+	{
+		if (capacity - used < max_number) flush();
+		if constexpr (std::same_as<T, bool>) {
+			buf[used++] = x ? '1' : '0';
+		} else if constexpr (character<T>) {
+			buf[used++] = char(x);
+		} else if constexpr (std::floating_point<T>) {
+			used = std::size_t(std::to_chars(buf + used, buf + capacity, x, std::chars_format::general, 6).ptr - buf);
+		} else {
+			used = std::size_t(std::to_chars(buf + used, buf + capacity, x).ptr - buf);
+		}
+	}
+
+	template<typename T>
+	requires (!std::is_arithmetic_v<T> && !std::convertible_to<const T&, std::string_view>)
+	void put(const T& x)
+	{
+		static thread_local std::ostringstream os;
+		os.str({});
+		os << x;
+		put(os.view());
+	}
+
+	void flush()
+	{
+		if (used) out.write(buf, used);
+		used = 0;
+	}
+
+private:
+	static constexpr std::size_t capacity = 1 << 16;
+	static constexpr std::size_t max_number = 64;	// longer than any to_chars result above
+	S& out;
+	std::size_t used = 0;
+	char buf[capacity];
+};
+
+// The elements of r, separated by ", " and followed by a newline
+template<std::ranges::range R, sink S>
+void put_elements(const R& r, S& out)
+{
+	Out_buffer b{out};
+	bool first = true;
+	for (auto&& elem : r) {
+		if (!first) b.put(std::string_view{", "});
+		b.put(elem);
+		first = false;
+	}
+	if (!first) b.put(std::string_view{"\n"});
+}
+
+template<typename T, sink S>
+void print(const std::vector<T>& vec, S& out)
+{
+	put_elements(vec, out);
+}
+
+template<typename T>
+void print(const std::vector<T>& vec)
+{
+	Fd_sink out = stdout_sink();
+	print(vec, out);
+}
+
+void print2(const std::vector<auto>& vec, sink auto& out)
+{
+	put_elements(vec, out);
+}
+
+void print2(const std::vector<auto>& vec)
+{
+	Fd_sink out = stdout_sink();
+	print2(vec, out);
+}
+
+void print3(const std::ranges::range auto& container, sink auto& out)
+{
+	put_elements(container, out);
+}
+
+void print3(const std::ranges::range auto& container)
+{
+	Fd_sink out = stdout_sink();
+	print3(container, out);
+}
+
+// The version in Cpp20Concepts.cc, on any stream
+template<typename T>
+void print_stream(const std::vector<T>& vec, std::ostream& os)
+{
+	for (size_t i = 0; auto& elem : vec)
+		os << elem << (++i == vec.size() ? "\n" : ", ");
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<typename T>
+void bench(const char* name, const std::vector<T>& v)
+{
+	// The same text as operator<<, on the first elements
+	std::vector<T> head(v.begin(), v.begin() + std::min<std::size_t>(v.size(), 100'000));
+	std::ostringstream expected;
+	print_stream(head, expected);
+	Memory_sink check;
+	print(head, check);
+
+	std::ofstream null_stream{"/dev/null"};
+	int null_fd = ::open("/dev/null", O_WRONLY);
+	Fd_sink null_sink{null_fd};
+	Memory_sink memory;
+	memory.text.reserve(v.size() * 16);
+	double t1 = time_ms([&] { print_stream(v, null_stream); null_stream.flush(); });
+	double t2 = time_ms([&] { print(v, null_sink); });
+	double t3 = time_ms([&] { print(v, memory); });
+	::close(null_fd);
+	std::printf("%-8s ofstream %8.1f ms   fd %7.1f ms %6.2fx   memory %7.1f ms (%zu MB)   same text: %s\n",
+		name, t1, t2, t1 / t2, t3, memory.text.size() >> 20, check.text == expected.str() ? "yes" : "NO");
+}
+
+int main(int argc, char* argv[])
+{
+	std::cout << "Before: ";
+	print(std::vector<int>{1, 2, 3});
+	print2(std::vector<double>{0.1, 1.0 / 3, 1e300, -0.0});
+	print3(std::vector<std::string>{"a", "bc"} | std::views::reverse);
+	print3(std::forward_list<int>{2, 4, 6});
+	std::vector<bool> flags{true, false};
+	print3(flags);
+	print(std::vector<char>{'x', 'y'});
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+	std::mt19937_64 rng{48};
+	std::vector<int> ints(n);
+	std::vector<double> doubles(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		ints[i] = int(rng());
+		doubles[i] = std::uniform_real_distribution<double>{-1e6, 1e6}(rng);
+	}
+	std::printf("%zu elements to /dev/null\n", n);
+	bench("int", ints);
+	bench("double", doubles);
+}
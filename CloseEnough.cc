@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/*
+	Comparing Arrays of Floating-Point Numbers
+	-------------------------------------
+	close_enough20(a, b) of Cpp20Concepts.cc compares one
+	pair. Checking two result arrays of 100M elements that
+	way is a scalar loop with a branch per element. The
+	functions below compare two spans a block of 64 elements
+	at a time, producing a 64-bit word with bit i set where
+	a[i] and b[i] differ; the words are all the three
+	answers need:
+
+	- count_mismatches: the sum of their popcounts;
+	- first_mismatch: the first nonzero word, then its
+	  lowest bit;
+	- mismatch_mask: the words themselves.
+
+	The tolerance is one of
+
+	- Absolute{eps}: |a - b| < eps, as close_enough20 does;
+	- Relative{eps}: |a - b| <= eps * max(|a|, |b|);
+	- Ulps{n}: at most n representable values apart. The
+	  bits of a float, read as a sign-magnitude integer and
+	  converted to two's complement, count the floats from
+	  zero, so the distance is a subtraction. (n is capped
+	  at 2^52 for double, 2^23 for float: a factor of two.)
+
+	Equal values always match (so do infinities of the same
+	sign, and +0 and -0); a NaN never does. Within a block
+	the comparison runs on vectors as wide as the target's
+	(GCC/Clang vector extensions), branch-free; other
+	compilers take the scalar close_enough for every pair.
+	Spans of different lengths are compared over the shorter.
+*/
+
+template<typename T>
+constexpr T absolute(T const a)
+{
+	return a < T{} ? -a : a;
+}
+
+template<typename T>
+constexpr T precision_threshold = T(0.000001);
+
+template<std::floating_point T>
+constexpr bool close_enough20(T a, T b)
+{
+	return absolute(a - b) < precision_threshold<T>;
+}
+
+struct Absolute { double eps; };
+struct Relative { double eps; };
+struct Ulps { std::uint64_t n; };
+
+template<typename Tol>
+concept tolerance = std::same_as<Tol, Absolute> || std::same_as<Tol, Relative> || std::same_as<Tol, Ulps>;
+
+// The types with a known bit layout (long double varies)
+template<typename T>
+concept ieee_float = std::same_as<T, float> || std::same_as<T, double>;
+
+template<ieee_float T>
+using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+
+// The floats between zero and x, negative below zero
+template<ieee_float T>
+auto ordered_int(T x)
+{
+	using U = Bits<T>;
+	constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+	U u = std::bit_cast<U>(x);
+	return std::make_signed_t<U>(u & sign ? sign - u : u);
+}
+
+template<ieee_float T>
+Bits<T> ulp_distance(T a, T b)
+{
+	auto x = ordered_int(a), y = ordered_int(b);
+	using U = Bits<T>;
+	return x > y ? U(x) - U(y) : U(y) - U(x);
+}
+
+// Tolerances beyond 2^mantissa ulps (a factor of two) are capped there
+template<ieee_float T>
+Bits<T> ulp_limit(Ulps tol)
+{
+	return Bits<T>(std::min<std::uint64_t>(tol.n, std::uint64_t(1) << (std::numeric_limits<T>::digits - 1)));
+}
+
+template<ieee_float T, tolerance Tol>
+constexpr bool close_enough(T a, T b, Tol tol)
+{
+	if (a == b) return true;
+	const T d = absolute(a - b);
+	if constexpr (std::same_as<Tol, Absolute>)
+		return d < T(tol.eps);
+	else if constexpr (std::same_as<Tol, Relative>)
+		return d <= T(tol.eps) * std::max(absolute(a), absolute(b)) && d < std::numeric_limits<T>::infinity();
+	else
+		return a == a && b == b && ulp_distance(a, b) <= ulp_limit<T>(tol);
+}
+
+// The target's vector width, as in Accumulate.cc
+#if defined(__AVX__)
+constexpr std::size_t simd_bytes = 32;
+#else
+constexpr std::size_t simd_bytes = 16;
+#endif
+
+#if defined(__GNUC__)
+template<ieee_float T>
+struct Lanes {
+	using U = Bits<T>;
+	using I = std::make_signed_t<U>;
+	typedef T V __attribute__((vector_size(simd_bytes)));
+	typedef U VU __attribute__((vector_size(simd_bytes)));
+	typedef I VI __attribute__((vector_size(simd_bytes)));
+	static constexpr std::size_t size = simd_bytes / sizeof(T);
+	static constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+
+	static V abs(V x) { return V(VU(x) & ~sign); }
+
+	// As ordered_int(), lane by lane
+	static VU ordered(V x)
+	{
+		VU u = VU(x);
+		VU neg = -(u >> (sizeof(U) * 8 - 1));
+		return (u & ~neg) | ((sign - u) & neg);
+	}
+};
+
+// All ones in the lanes where close_enough(a, b, tol) is false
+template<ieee_float T, tolerance Tol>
+auto mismatch_lanes(typename Lanes<T>::V a, typename Lanes<T>::V b, Tol tol)
+{
+	using L = Lanes<T>;
+	using VI = typename L::VI;
+	VI close;
+	if constexpr (std::same_as<Tol, Absolute>) {
+		close = L::abs(a - b) < T(tol.eps);
+	} else if constexpr (std::same_as<Tol, Relative>) {
+		auto d = L::abs(a - b), x = L::abs(a), y = L::abs(b);
+		auto m = x < y ? y : x;
+		close = (d <= T(tol.eps) * m) & (d < std::numeric_limits<T>::infinity());
+	} else {
+		// -n <= x - y <= n, as one unsigned comparison
+		const typename L::U n = ulp_limit<T>(tol);
+		close = ((L::ordered(a) - L::ordered(b) + n) <= 2 * n) & (a == a) & (b == b);
+	}
+	return ~((a == b) | close);
+}
+#endif
+
+// Bit i set where a[i] and b[i] differ, for m <= 64 pairs
+template<ieee_float T, tolerance Tol>
+std::uint64_t mismatch_word(const T* a, const T* b, std::size_t m, Tol tol)
+{
+	std::uint64_t w = 0;
+	std::size_t i = 0;
+#if defined(__GNUC__)
+	using L = Lanes<T>;
+	using U = typename L::U;
+	if (m == 64) {
+		// Lane l of vector k holds bit k + l; one lane's worth of bits at a time
+		typename L::VU weights;
+		for (std::size_t l = 0; l < L::size; ++l)
+			weights[l] = U(1) << l;
+		for (std::size_t g = 0; g < 64; g += sizeof(U) * 8) {
+			typename L::VU bits = {};
+			for (std::size_t k = 0; k < sizeof(U) * 8; k += L::size) {
+				typename L::V x, y;
+				std::memcpy(&x, a + g + k, sizeof x);
+				std::memcpy(&y, b + g + k, sizeof y);
+				bits |= (typename L::VU(mismatch_lanes<T>(x, y, tol)) & weights) << k;
+			}
+			U word = 0;
+			for (std::size_t l = 0; l < L::size; ++l)
+				word |= bits[l];
+			w |= std::uint64_t(word) << g;
+		}
+		return w;
+	}
+#endif
+	for (; i < m; ++i)
+		w |= std::uint64_t(!close_enough(a[i], b[i], tol)) << i;
+	return w;
+}
+
+template<ieee_float T, tolerance Tol>
+std::size_t count_mismatches(std::span<const T> a, std::span<const T> b, Tol tol)
+{
+	const std::size_t n = std::min(a.size(), b.size());
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < n; i += 64)
+		count += std::popcount(mismatch_word(a.data() + i, b.data() + i, std::min<std::size_t>(64, n - i), tol));
+	return count;
+}
+
+// The index of the first pair that differs; the length if none does
+template<ieee_float T, tolerance Tol>
+std::size_t first_mismatch(std::span<const T> a, std::span<const T> b, Tol tol)
+{
+	const std::size_t n = std::min(a.size(), b.size());
+	for (std::size_t i = 0; i < n; i += 64)
+		if (auto w = mismatch_word(a.data() + i, b.data() + i, std::min<std::size_t>(64, n - i), tol))
+			return i + std::size_t(std::countr_zero(w));
+	return n;
+}
+
+// Bit i % 64 of word i / 64 set where a[i] and b[i] differ
+template<ieee_float T, tolerance Tol>
+std::vector<std::uint64_t> mismatch_mask(std::span<const T> a, std::span<const T> b, Tol tol)
+{
+	const std::size_t n = std::min(a.size(), b.size());
+	std::vector<std::uint64_t> mask((n + 63) / 64);
+	for (std::size_t i = 0; i < n; i += 64)
+		mask[i / 64] = mismatch_word(a.data() + i, b.data() + i, std::min<std::size_t>(64, n - i), tol);
+	return mask;
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<ieee_float T, tolerance Tol>
+void bench(const char* name, const std::vector<T>& a, const std::vector<T>& b, Tol tol)
+{
+	std::span<const T> x{a}, y{b};
+	std::size_t c1 = 0, c2 = 0, first = 0, bits = 0;
+	double t1 = time_ms([&] {
+		for (std::size_t i = 0; i < a.size(); ++i)
+			if (!close_enough(a[i], b[i], tol)) ++c1;
+	});
+	double t2 = time_ms([&] { c2 = count_mismatches(x, y, tol); });
+	double t3 = time_ms([&] { first = first_mismatch(x, y, tol); });
+	double t4 = time_ms([&] {
+		for (auto w : mismatch_mask(x, y, tol)) bits += std::size_t(std::popcount(w));
+	});
+	std::printf("%-16s scalar %7.1f ms   count %6.1f ms %5.2fx   first %6.1f ms   mask %6.1f ms   (%zu %zu %zu, first %zu)\n",
+		name, t1, t2, t1 / t2, t3, t4, c1, c2, bits, first);
+}
+
+int main(int argc, char* argv[])
+{
+	double x[] = {1.0, 1.0 + 1e-7, 1.0 + 1e-3, 0.0, std::numeric_limits<double>::quiet_NaN()};
+	double y[] = {1.0, 1.0, 1.0, -0.0, std::numeric_limits<double>::quiet_NaN()};
+	std::printf("close_enough20: %d %d %d; mismatches: absolute %zu, relative 1e-2 %zu, 2 ulps %zu, first %zu\n",
+		close_enough20(x[0], y[0]), close_enough20(x[1], y[1]), close_enough20(x[2], y[2]),
+		count_mismatches<double>(x, y, Absolute{precision_threshold<double>}),
+		count_mismatches<double>(x, y, Relative{1e-2}), count_mismatches<double>(x, y, Ulps{2}),
+		first_mismatch<double>(x, y, Ulps{2}));
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+	std::mt19937_64 rng{46};
+	std::uniform_real_distribution<double> u{-1e3, 1e3};
+	std::vector<double> a(n), b(n);
+	std::vector<float> fa(n), fb(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		a[i] = u(rng);
+		// Results from a slightly different evaluation order: a few ulps off, rarely far
+		b[i] = rng() % 10000 ? std::bit_cast<double>(std::bit_cast<std::uint64_t>(a[i]) + rng() % 4) : a[i] * 1.01;
+		fa[i] = float(a[i]);
+		fb[i] = float(b[i]);
+	}
+	std::printf("%zu pairs\n", n);
+	bench("double absolute", a, b, Absolute{1e-9});
+	bench("double relative", a, b, Relative{1e-12});
+	bench("double 4 ulps", a, b, Ulps{4});
+	bench("float relative", fa, fb, Relative{1e-6});
+	bench("float 4 ulps", fa, fb, Ulps{4});
+}
@@ -0,0 +1,913 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+	Sorting Container<T> in Parallel
+	-------------------------------------
+	Container<T> of Template_Instantiation.cc wraps a
+	vector<T> and declares sort(). Here sort() is defined:
+	small inputs take the serial std::sort path, larger ones
+	a parallel sample sort on the work-stealing pool of
+	ThreadPool.h.
+
+	Sample sort is quicksort with many pivots at once:
+
+	1. Pick k - 1 splitters from a sorted random sample;
+	   they cut the key space into k buckets of roughly
+	   equal size.
+	2. In parallel, each block of the input counts how many
+	   of its elements fall into each bucket; prefix sums
+	   give every (block, bucket) pair its own output range,
+	   so the scatter needs no synchronization.
+	3. Sort the buckets independently, in parallel.
+
+	Every element moves twice (out and back) and each step
+	is a parallel loop over contiguous memory, so it scales
+	until memory bandwidth runs out.
+
+	The result is sorted but, like std::sort, not stable,
+	unless asked to be: the scatter keeps the input order
+	within each bucket, so stable sorting the buckets (and
+	std::stable_sort below the parallel threshold) is
+	enough.
+	T must be default constructible and movable.
+
+	Integer and floating-point keys need no comparisons
+	at all, and strings need far fewer; see Radix Sorting
+	Numeric Keys and Radix Sorting Strings below.
+*/
+
+/*
+	Radix Sorting Numeric Keys
+	-------------------------------------
+	An LSD radix sort orders n keys of b bytes with b
+	counting passes: each pass scatters the elements by
+	one byte, starting from the least significant one, and
+	keeps the order of equal bytes, so after the last pass
+	the keys are sorted. That is O(b * n) with sequential
+	reads and 256 sequential write streams per pass, against
+	the n log n unpredictable branches of a comparison sort.
+
+	It needs the key's bits to order like the key itself:
+
+	- unsigned integers already do;
+	- signed integers do once the sign bit is flipped;
+	- IEEE floats are sign-magnitude: flipping the sign bit
+	  of positive values and all bits of negative values
+	  gives an unsigned order with -inf < ... < -0 < +0
+	  < ... < +inf (NaNs go to the ends by sign).
+
+	The dispatch is by concept, as in Cpp20Concepts.cc:
+	sort_keys() has an overload constrained on radix_key
+	results of the key projection and an unconstrained one
+	that compares, and overload resolution picks the more
+	constrained one when it applies. So Container<int>::sort(),
+	Container<double>::sort(std::greater<>{}) and
+	Container<Person>::sort_by(&Person::age) radix sort,
+	and everything else goes to the sample sort above.
+
+	sort_keys() is stable at every size: radix sort is
+	stable, and so is the comparison sort it uses below
+	radix_threshold. Small records are moved through
+	every pass; larger ones (such as a Person with its
+	string) are radix sorted as (key, index) pairs and
+	then moved into place once.
+*/
+
+template<typename T>
+concept radix_key = (std::integral<T> && !std::same_as<T, bool>)
+	|| (std::floating_point<T> && (sizeof(T) == 4 || sizeof(T) == 8));
+
+template<typename Key, typename T>
+concept radix_projection = radix_key<std::remove_cvref_t<std::invoke_result_t<Key&, const T&>>>;
+
+template<typename Compare, typename T>
+concept ascending_order = std::same_as<Compare, std::less<T>> || std::same_as<Compare, std::less<>>;
+
+template<typename Compare, typename T>
+concept descending_order = std::same_as<Compare, std::greater<T>> || std::same_as<Compare, std::greater<>>;
+
+// The key's bits, as an unsigned integer that orders like the key
+template<radix_key K>
+auto radix_bits(K k)
+{
+	if constexpr (std::floating_point<K>) {
+		using U = std::conditional_t<sizeof(K) == 4, std::uint32_t, std::uint64_t>;
+		constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+		U u = std::bit_cast<U>(k);
+		return u & sign ? U(~u) : U(u | sign);
+	} else {
+		using U = std::make_unsigned_t<K>;
+		U u = U(k);
+		if constexpr (std::signed_integral<K>)
+			u ^= U(1) << (sizeof(U) * 8 - 1);
+		return u;
+	}
+}
+
+/*
+	Sorts [src, src + n) by bits(x) using dst as scratch;
+	returns whichever of the two holds the result. A pass
+	whose byte is the same for every element is skipped,
+	so narrow key ranges cost fewer passes.
+*/
+template<typename T, typename Bits>
+T* radix_passes(T* src, T* dst, std::size_t n, Bits bits)
+{
+	using U = decltype(bits(*src));
+	constexpr int passes = sizeof(U);
+	std::size_t count[passes][256] = {};
+	for (std::size_t i = 0; i < n; ++i) {
+		U u = bits(src[i]);
+		for (int p = 0; p < passes; ++p)
+			++count[p][(u >> (8 * p)) & 0xff];
+	}
+	for (int p = 0; p < passes; ++p) {
+		std::size_t* c = count[p];
+		if (c[(bits(src[0]) >> (8 * p)) & 0xff] == n) continue;
+		std::size_t offset = 0;
+		for (int b = 0; b < 256; ++b)
+			offset += std::exchange(c[b], offset);
+		for (std::size_t i = 0; i < n; ++i)
+			dst[c[(bits(src[i]) >> (8 * p)) & 0xff]++] = std::move(src[i]);
+		std::swap(src, dst);
+	}
+	return src;
+}
+
+/*
+	Large inputs: 256-way scatter passes over memory that
+	doesn't fit in cache miss the TLB on most writes. So
+	they are split MSD first, by their highest byte that
+	varies, until each bucket fits in cache, and the LSD
+	passes run there. Bytes above the split are equal
+	within a bucket, so their LSD passes are skipped.
+*/
+template<typename T, typename Bits>
+T* radix_sort_range(T* src, T* dst, std::size_t n, Bits bits, int byte = -1)
+{
+	using U = decltype(bits(*src));
+	constexpr std::size_t cache_elements = (std::size_t(1) << 19) / sizeof(T);
+	if (byte < 0) byte = sizeof(U) - 1;
+	if (byte == 0 || n <= cache_elements)
+		return radix_passes(src, dst, n, bits);
+
+	std::size_t start[257] = {};
+	for (std::size_t i = 0; i < n; ++i)
+		++start[((bits(src[i]) >> (8 * byte)) & 0xff) + 1];
+	if (start[((bits(src[0]) >> (8 * byte)) & 0xff) + 1] == n)
+		return radix_sort_range(src, dst, n, bits, byte - 1);
+	for (int b = 0; b < 256; ++b)
+		start[b + 1] += start[b];
+	std::size_t pos[256];
+	std::copy(start, start + 256, pos);
+	for (std::size_t i = 0; i < n; ++i)
+		dst[pos[(bits(src[i]) >> (8 * byte)) & 0xff]++] = std::move(src[i]);
+
+	for (int b = 0; b < 256; ++b) {
+		std::size_t len = start[b + 1] - start[b];
+		if (len == 0) continue;
+		T* r = radix_sort_range(dst + start[b], src + start[b], len, bits, byte - 1);
+		if (r != src + start[b]) std::move(r, r + len, src + start[b]);
+	}
+	return src;
+}
+
+// Reorders v so that element i is the old v[order[i].index]
+template<typename T, typename Tagged>
+void permute(std::vector<T>& v, const Tagged* order)
+{
+	std::vector<T> out;
+	out.reserve(v.size());
+	for (std::size_t i = 0; i < v.size(); ++i)
+		out.push_back(std::move(v[order[i].index]));
+	v = std::move(out);
+}
+
+template<typename T, typename Key>
+void lsd_radix_sort(std::vector<T>& v, Key key, bool descending = false)
+{
+	const std::size_t n = v.size();
+	if (n < 2) return;
+	auto bits = [&](const T& x) {
+		auto u = radix_bits(std::invoke(key, x));
+		return descending ? decltype(u)(~u) : u;
+	};
+	using U = decltype(bits(v[0]));
+
+	if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= 16) {
+		std::vector<T> buf(n);
+		T* r = radix_sort_range(v.data(), buf.data(), n, bits);
+		if (r != v.data()) std::copy(r, r + n, v.data());
+	} else {
+		struct Tagged { U bits; std::size_t index; };
+		std::vector<Tagged> a(n), b(n);
+		for (std::size_t i = 0; i < n; ++i)
+			a[i] = {bits(v[i]), i};
+		Tagged* r = radix_sort_range(a.data(), b.data(), n, [](const Tagged& t) { return t.bits; });
+		permute(v, r);
+	}
+}
+
+/*
+	Radix Sorting Strings
+	-------------------------------------
+	A comparison sort of n strings compares each pair from
+	the first character, so strings that share a long
+	prefix (surnames, "person" + number, URLs) have that
+	prefix compared again at every one of their n log n
+	comparisons.
+
+	MSD radix sort and multikey quicksort look at each
+	character position once per group of strings that
+	agree on everything before it:
+
+	- MSD radix sort scatters a large group by the character
+	  at depth d into 256 buckets (plus one for strings that
+	  have ended), then sorts each bucket from depth d + 1;
+	- multikey quicksort, for medium groups and for wider
+	  character types, partitions three ways around one
+	  pivot character: less, equal and greater. Only the
+	  equal part moves on to depth d + 1;
+	- tiny groups are finished by insertion sort from d.
+
+	The strings are not moved while sorting: the sort runs
+	over (pointer, length, index) references to them, and the
+	elements are moved into place once at the end.
+
+	Any projection that yields a reference to a string_key
+	(std::string, std::string_view, String<C> below, with
+	integral characters) selects this overload of
+	sort_keys(), so Container<std::string>::sort() and
+	Container<Person>::sort_by(&Person::name) use it.
+	Characters compare as unsigned, like std::string.
+	Unlike std::sort it is stable: a reference carries its
+	element's index, which breaks ties between equal
+	strings (the MSD passes keep the order by themselves).
+*/
+
+// As in Tutorial_1.cc, with the accessors a sort needs
+template<typename C>
+class String {
+public:
+	using value_type = C;
+
+	String() : sz{0}, ptr{ch} { ch[0] = {}; }
+	explicit String(const C* p) : String() { while (*p != C{}) *this += *p++; }
+	String(const String& s) : String() { for (int i = 0; i < s.sz; ++i) *this += s.ptr[i]; }
+	String(String&& s) noexcept : String() { steal(s); }
+	String& operator=(const String& s) { return *this = String{s}; }
+	String& operator=(String&& s) noexcept
+	{
+		if (this != &s) {
+			release();
+			steal(s);
+		}
+		return *this;
+	}
+	~String() { release(); }
+
+	C& operator[](int n) { return ptr[n]; }
+	C operator[](int n) const { return ptr[n]; }
+	String& operator+=(C c)
+	{
+		int cap = ptr == ch ? short_max : space;
+		if (sz == cap) {
+			int n = 2 * cap + 2;
+			C* p = new C[n + 1];
+			std::copy(ptr, ptr + sz + 1, p);
+			release();
+			ptr = p;
+			space = n;
+		}
+		ptr[sz++] = c;
+		ptr[sz] = {};
+		return *this;
+	}
+
+	int size() const { return sz; }
+	const C* data() const { return ptr; }
+
+private:
+	void release() { if (ptr != ch) delete[] ptr; ptr = ch; }
+	void steal(String& s)
+	{
+		sz = s.sz;
+		if (s.ptr == s.ch) {
+			std::copy(s.ch, s.ch + sz + 1, ch);
+		} else {
+			ptr = s.ptr;
+			space = s.space;
+		}
+		s.ptr = s.ch;
+		s.sz = 0;
+		s.ch[0] = {};
+	}
+
+	static const int short_max = 15;
+	int sz;
+	C* ptr;
+	union {
+		int space;	// unused allocation
+		C ch[short_max + 1];
+	};
+};
+
+template<typename C>
+bool operator<(const String<C>& a, const String<C>& b)
+{
+	using U = std::make_unsigned_t<C>;
+	return std::lexicographical_compare(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(),
+		[](C x, C y) { return U(x) < U(y); });
+}
+
+template<typename S>
+concept string_key = std::integral<typename S::value_type> && requires(const S& s) {
+	{ s.data() } -> std::convertible_to<const typename S::value_type*>;
+	{ s.size() } -> std::convertible_to<std::size_t>;
+};
+
+// The key must be a reference: the sort keeps pointers into it
+template<typename Key, typename T>
+concept string_projection = std::is_lvalue_reference_v<std::invoke_result_t<Key&, const T&>>
+	&& string_key<std::remove_cvref_t<std::invoke_result_t<Key&, const T&>>>;
+
+template<typename C>
+struct Str_ref {
+	const C* s;
+	std::size_t n;
+	std::size_t index;
+};
+
+// The character at depth d; 0 once the string has ended
+template<typename C>
+std::size_t char_at(const Str_ref<C>& r, std::size_t d)
+{
+	return d < r.n ? std::size_t(std::make_unsigned_t<C>(r.s[d])) + 1 : 0;
+}
+
+template<typename C>
+bool suffix_less(const Str_ref<C>& a, const Str_ref<C>& b, std::size_t d)
+{
+	for (;; ++d) {
+		std::size_t x = char_at(a, d), y = char_at(b, d);
+		if (x != y) return x < y;
+		if (x == 0) return a.index < b.index;
+	}
+}
+
+// Sorts a[0, n), whose strings agree on their first d characters
+template<typename C>
+void insertion_sort(Str_ref<C>* a, std::size_t n, std::size_t d)
+{
+	for (std::size_t i = 1; i < n; ++i) {
+		Str_ref<C> t = a[i];
+		std::size_t j = i;
+		for (; j > 0 && suffix_less(t, a[j - 1], d); --j)
+			a[j] = a[j - 1];
+		a[j] = t;
+	}
+}
+
+template<typename C>
+void multikey_quicksort(Str_ref<C>* a, std::size_t n, std::size_t d)
+{
+	while (n > 16) {
+		std::size_t x = char_at(a[0], d), y = char_at(a[n / 2], d), z = char_at(a[n - 1], d);
+		std::size_t pivot = std::max(std::min(x, y), std::min(std::max(x, y), z));
+		// [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot
+		std::size_t lt = 0, i = 0, gt = n;
+		while (i < gt) {
+			std::size_t c = char_at(a[i], d);
+			if (c < pivot) std::swap(a[lt++], a[i++]);
+			else if (c > pivot) std::swap(a[i], a[--gt]);
+			else ++i;
+		}
+		multikey_quicksort(a, lt, d);
+		multikey_quicksort(a + gt, n - gt, d);
+		if (pivot == 0) {
+			// The equal part has ended: equal strings, kept in their original order
+			std::sort(a + lt, a + gt, [](const Str_ref<C>& x, const Str_ref<C>& y) { return x.index < y.index; });
+			return;
+		}
+		a += lt;
+		n = gt - lt;
+		++d;
+	}
+	insertion_sort(a, n, d);
+}
+
+/*
+	MSD passes for byte-sized characters while a group is
+	large, multikey quicksort below that. Given a pool, the
+	buckets of the first pass are sorted in parallel.
+
+	A shared prefix character and the largest bucket are
+	taken by the loop rather than by recursion, so a long
+	common prefix costs no stack and the recursion (into
+	buckets of at most half the strings) stays O(log n)
+	deep.
+*/
+template<typename C>
+void msd_radix_sort(Str_ref<C>* a, Str_ref<C>* tmp, std::uint16_t* chars,
+	std::size_t n, std::size_t d, Thread_pool* pool = nullptr)
+{
+	for (;; ++d) {
+		if (sizeof(C) > 1 || n < (1 << 12)) {
+			multikey_quicksort(a, n, d);
+			return;
+		}
+		// One read of each string per pass; the scatter reuses it
+		std::size_t start[258] = {};
+		for (std::size_t i = 0; i < n; ++i)
+			++start[(chars[i] = std::uint16_t(char_at(a[i], d))) + 1];
+		// A shared prefix character: nothing to scatter
+		if (start[chars[0] + 1] == n) {
+			if (chars[0] == 0) return;
+			continue;
+		}
+		for (int b = 0; b < 257; ++b)
+			start[b + 1] += start[b];
+		std::size_t pos[257];
+		std::copy(start, start + 257, pos);
+		for (std::size_t i = 0; i < n; ++i)
+			tmp[pos[chars[i]]++] = a[i];
+		std::copy(tmp, tmp + n, a);
+
+		// Bucket 0 holds the strings that have ended: all equal, still in their original order
+		auto bucket = [=, &start](int b) {
+			msd_radix_sort(a + start[b], tmp + start[b], chars + start[b], start[b + 1] - start[b], d + 1);
+		};
+		if (pool && pool->size() > 1) {
+			Task_group g{*pool};
+			for (int b = 1; b < 257; ++b)
+				if (start[b + 1] > start[b]) g.run([&bucket, b] { bucket(b); });
+			g.wait();
+			return;
+		}
+		int largest = 1;
+		for (int b = 2; b < 257; ++b)
+			if (start[b + 1] - start[b] > start[largest + 1] - start[largest]) largest = b;
+		for (int b = 1; b < 257; ++b)
+			if (b != largest) bucket(b);
+		a += start[largest];
+		tmp += start[largest];
+		chars += start[largest];
+		n = start[largest + 1] - start[largest];
+	}
+}
+
+template<typename T, typename Key>
+void string_sort(std::vector<T>& v, Key key, bool descending, Thread_pool& pool)
+{
+	using S = std::remove_cvref_t<std::invoke_result_t<Key&, const T&>>;
+	using C = typename S::value_type;
+	const std::size_t n = v.size();
+	std::vector<Str_ref<C>> a(n), tmp(n);
+	std::vector<std::uint16_t> chars(n);
+	// Descending is the ascending order reversed, so equal strings go in
+	// from the back (their index counted from there) to come out in order
+	for (std::size_t i = 0; i < n; ++i) {
+		const S& s = std::invoke(key, v[descending ? n - 1 - i : i]);
+		a[i] = {s.data(), std::size_t(s.size()), i};
+	}
+	msd_radix_sort(a.data(), tmp.data(), chars.data(), n, 0, &pool);
+	if (descending) {
+		std::reverse(a.begin(), a.end());
+		for (auto& r : a) r.index = n - 1 - r.index;
+	}
+	permute(v, a.data());
+}
+
+/*
+	Sorting Incrementally
+	-------------------------------------
+	Data that arrives in small batches between queries
+	should not be sorted from scratch every time. Container
+	remembers how long its sorted prefix is:
+
+	- push_back() appends to the unsorted tail (or extends
+	  the prefix, if the element is in order);
+	- sort() sorts only the tail and merges it in from the
+	  back, which moves just the prefix elements larger than
+	  the smallest new one;
+	- smallest(k) and nth(k) serve a top-k or a single rank
+	  with partial_sort or nth_element when the tail is too
+	  large for sort() to pay off.
+
+	The prefix is in ascending (operator<) order. Other
+	orders sort everything, and so does mutable access:
+	operator[](i) shortens the prefix to i, begin() to 0.
+*/
+
+template<typename T>
+class Container {
+	std::vector<T> v; // elements
+	std::size_t sorted = 0; // v[0, sorted) is in ascending order
+public:
+	Container() = default;
+	explicit Container(std::vector<T> elems) : v{std::move(elems)} {}
+
+	void push_back(const T& x)
+	{
+		if constexpr (requires { x < x; })
+			if (sorted == v.size() && (v.empty() || !(x < v.back()))) ++sorted;
+		v.push_back(x);
+	}
+	std::size_t size() const { return v.size(); }
+	std::size_t sorted_size() const { return sorted; }
+	T& operator[](std::size_t i) { sorted = std::min(sorted, i); return v[i]; }
+	const T& operator[](std::size_t i) const { return v[i]; }
+	auto begin() { sorted = 0; return v.begin(); }
+	auto end() { return v.end(); }
+	auto begin() const { return v.begin(); }
+	auto end() const { return v.end(); }
+
+	static constexpr std::size_t parallel_threshold = 1 << 17;
+	// Below this std::sort's insertion sort beats the radix passes
+	static constexpr std::size_t radix_threshold = 1 << 10;
+
+	// sort elements
+	void sort() { sort(std::less<T>{}); }
+
+	template<typename Compare>
+	void sort(Compare cmp, Thread_pool& pool = Thread_pool::shared());
+
+	// sort elements by key(x), ascending; stable at every size (equal keys keep their order)
+	template<typename Key>
+	void sort_by(Key key, Thread_pool& pool = Thread_pool::shared());
+
+	// The k smallest elements, in order
+	std::span<const T> smallest(std::size_t k);
+
+	// The element sort() would put at position k; k < size(), else out_of_range
+	const T& nth(std::size_t k);
+
+private:
+	void sort_tail(Thread_pool& pool);
+
+	// sort() is cheaper than partial_sort/nth_element over all
+	bool tail_is_small() const { return 4 * (v.size() - sorted) <= v.size(); }
+};
+
+template<typename T, typename Compare>
+void sample_sort(std::vector<T>& v, Compare cmp, Thread_pool& pool, bool stable = false)
+{
+	const std::size_t n = v.size();
+	const std::size_t threads = pool.size();
+	if (threads == 1 || n < Container<T>::parallel_threshold) {
+		if (stable) std::stable_sort(v.begin(), v.end(), cmp);
+		else std::sort(v.begin(), v.end(), cmp);
+		return;
+	}
+
+	// 1. Splitters from an oversampled random sample
+	const std::size_t buckets = std::min<std::size_t>(threads * 8, 1024);
+	const std::size_t oversample = 32;
+	std::vector<T> sample;
+	sample.reserve(buckets * oversample);
+	std::mt19937_64 rng{n};
+	for (std::size_t i = 0; i < buckets * oversample; ++i)
+		sample.push_back(v[rng() % n]);
+	std::sort(sample.begin(), sample.end(), cmp);
+	std::vector<T> split;
+	for (std::size_t i = 1; i < buckets; ++i)
+		split.push_back(sample[i * oversample]);
+
+	auto bucket_of = [&](const T& x) {
+		return std::size_t(std::upper_bound(split.begin(), split.end(), x, cmp) - split.begin());
+	};
+
+	// 2. Count per (block, bucket), then scatter
+	const std::size_t blocks = threads * 4;
+	std::vector<std::size_t> counts(blocks * buckets);
+	std::vector<std::uint16_t> which(n);
+	{
+		Task_group g{pool};
+		for (std::size_t b = 0; b < blocks; ++b)
+			g.run([&, b] {
+				std::size_t* c = &counts[b * buckets];
+				for (std::size_t i = n * b / blocks, e = n * (b + 1) / blocks; i < e; ++i)
+					++c[which[i] = std::uint16_t(bucket_of(v[i]))];
+			});
+		g.wait();
+	}
+	// Bucket-major prefix sums: bucket k of block b starts after
+	// all of buckets < k, then bucket k of blocks < b.
+	std::vector<std::size_t> bucket_start(buckets + 1);
+	std::size_t offset = 0;
+	for (std::size_t k = 0; k < buckets; ++k) {
+		bucket_start[k] = offset;
+		for (std::size_t b = 0; b < blocks; ++b) {
+			std::size_t c = counts[b * buckets + k];
+			counts[b * buckets + k] = offset;
+			offset += c;
+		}
+	}
+	bucket_start[buckets] = n;
+
+	std::vector<T> out(n);
+	{
+		Task_group g{pool};
+		for (std::size_t b = 0; b < blocks; ++b)
+			g.run([&, b] {
+				std::size_t* pos = &counts[b * buckets];
+				for (std::size_t i = n * b / blocks, e = n * (b + 1) / blocks; i < e; ++i)
+					out[pos[which[i]]++] = std::move(v[i]);
+			});
+		g.wait();
+	}
+
+	// 3. Sort buckets and move them back
+	{
+		Task_group g{pool};
+		for (std::size_t k = 0; k < buckets; ++k)
+			g.run([&, k] {
+				auto first = out.begin() + bucket_start[k];
+				auto last = out.begin() + bucket_start[k + 1];
+				if (stable) std::stable_sort(first, last, cmp);
+				else std::sort(first, last, cmp);
+				std::move(first, last, v.begin() + bucket_start[k]);
+			});
+		g.wait();
+	}
+}
+
+template<typename T, typename Key>
+void compare_sort_keys(std::vector<T>& v, Key key, bool descending, Thread_pool& pool)
+{
+	auto less = [&](const T& a, const T& b) { return std::invoke(key, a) < std::invoke(key, b); };
+	auto greater = [&](const T& a, const T& b) { return std::invoke(key, b) < std::invoke(key, a); };
+	if (descending) sample_sort(v, greater, pool, true);
+	else sample_sort(v, less, pool, true);
+}
+
+template<typename T, typename Key>
+void sort_keys(std::vector<T>& v, Key key, bool descending, Thread_pool& pool)
+{
+	compare_sort_keys(v, key, descending, pool);
+}
+
+template<typename T, typename Key>
+requires radix_projection<Key, T>
+void sort_keys(std::vector<T>& v, Key key, bool descending, Thread_pool& pool)
+{
+	if (v.size() < Container<T>::radix_threshold) {
+		compare_sort_keys(v, key, descending, pool);
+		return;
+	}
+	lsd_radix_sort(v, key, descending);
+}
+
+template<typename T, typename Key>
+requires string_projection<Key, T>
+void sort_keys(std::vector<T>& v, Key key, bool descending, Thread_pool& pool)
+{
+	if (v.size() < Container<T>::radix_threshold) {
+		compare_sort_keys(v, key, descending, pool);
+		return;
+	}
+	string_sort(v, key, descending, pool);
+}
+
+template<typename T>
+void Container<T>::sort_tail(Thread_pool& pool)
+{
+	if (sorted == v.size()) return;
+	if (sorted == 0) {
+		sort_keys(v, std::identity{}, false, pool);
+		sorted = v.size();
+		return;
+	}
+	std::vector<T> tail(std::make_move_iterator(v.begin() + sorted), std::make_move_iterator(v.end()));
+	sort_keys(tail, std::identity{}, false, pool);
+
+	// Merge from the back; equal elements keep the prefix ones first
+	std::size_t i = sorted, j = tail.size(), out = v.size();
+	while (j > 0) {
+		if (i > 0 && tail[j - 1] < v[i - 1]) v[--out] = std::move(v[--i]);
+		else v[--out] = std::move(tail[--j]);
+	}
+	sorted = v.size();
+}
+
+template<typename T>
+template<typename Compare>
+void Container<T>::sort(Compare cmp, Thread_pool& pool)
+{
+	if constexpr (ascending_order<Compare, T>) {
+		sort_tail(pool);
+		return;
+	} else if constexpr (descending_order<Compare, T>) {
+		sort_keys(v, std::identity{}, true, pool);
+	} else {
+		sample_sort(v, cmp, pool);
+	}
+	sorted = 0;
+}
+
+template<typename T>
+template<typename Key>
+void Container<T>::sort_by(Key key, Thread_pool& pool)
+{
+	sort_keys(v, key, false, pool);
+	sorted = 0;
+}
+
+template<typename T>
+std::span<const T> Container<T>::smallest(std::size_t k)
+{
+	k = std::min(k, v.size());
+	if (tail_is_small() || 2 * k >= v.size()) {
+		sort();
+	} else {
+		// Leaves v[0, k) sorted: a new, shorter prefix
+		std::partial_sort(v.begin(), v.begin() + k, v.end());
+		sorted = k;
+	}
+	return {v.data(), k};
+}
+
+template<typename T>
+const T& Container<T>::nth(std::size_t k)
+{
+	if (k >= v.size()) throw std::out_of_range{"Container::nth: k >= size()"};
+	if (tail_is_small()) {
+		sort();
+	} else {
+		std::nth_element(v.begin(), v.begin() + k, v.end());
+		sorted = 0;
+	}
+	return v[k];
+}
+
+struct Person {
+	std::string name;
+	int age;
+};
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	Container<int> c;
+	for (int x : {5, 3, 9, 1, 7}) c.push_back(x);
+	c.sort();
+	c.sort(std::greater<int>{});
+	for (int x : c) std::printf("%d ", x);
+	std::printf("\n");
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+	const unsigned max_threads = argc > 2 ? unsigned(std::atoi(argv[2]))
+		: std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::uint64_t> input(n);
+	std::mt19937_64 rng{1};
+	for (auto& x : input) x = rng();
+
+	std::vector<std::uint64_t> ref = input;
+	double t_std = time_ms([&] { std::sort(ref.begin(), ref.end()); });
+	std::printf("%zu keys, std::sort %.1f ms\n", n, t_std);
+	std::printf("threads  sample sort ms  speedup\n");
+	for (unsigned t = 1; t <= max_threads; t *= 2) {
+		Thread_pool pool{t};
+		Container<std::uint64_t> data{input};
+		// A lambda comparator keeps the comparison path
+		auto less = [](std::uint64_t a, std::uint64_t b) { return a < b; };
+		double ms = time_ms([&] { data.sort(less, pool); });
+		bool ok = std::equal(data.begin(), data.end(), ref.begin());
+		std::printf("%7u  %14.1f  %7.2f%s\n", t, ms, t_std / ms, ok ? "" : "  WRONG");
+	}
+	std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+
+	// Radix dispatch: integers, floats, and a numeric projection
+	{
+		Container<std::uint64_t> data{input};
+		double ms = time_ms([&] { data.sort(); });
+		bool ok = std::equal(data.begin(), data.end(), ref.begin());
+		std::printf("uint64  radix %8.1f ms  %5.2fx std::sort%s\n", ms, t_std / ms, ok ? "" : "  WRONG");
+	}
+	{
+		std::vector<double> d(n);
+		std::normal_distribution<double> dist{0, 1e6};
+		for (auto& x : d) x = dist(rng);
+		std::vector<double> dref = d;
+		double t_cmp = time_ms([&] { std::sort(dref.begin(), dref.end(), std::greater<>{}); });
+		Container<double> data{std::move(d)};
+		double ms = time_ms([&] { data.sort(std::greater<>{}); });
+		bool ok = std::equal(data.begin(), data.end(), dref.begin());
+		std::printf("double  radix %8.1f ms  %5.2fx std::sort (descending)%s\n", ms, t_cmp / ms, ok ? "" : "  WRONG");
+	}
+	{
+		const std::size_t m = n / 4;
+		std::vector<Person> people;
+		people.reserve(m);
+		for (std::size_t i = 0; i < m; ++i)
+			people.push_back({"person" + std::to_string(i), int(rng() % 100)});
+		std::vector<Person> pref = people;
+		double t_cmp = time_ms([&] {
+			std::stable_sort(pref.begin(), pref.end(),
+				[](const Person& a, const Person& b) { return a.age < b.age; });
+		});
+		Container<Person> data{std::move(people)};
+		double ms = time_ms([&] { data.sort_by(&Person::age); });
+		bool ok = std::equal(data.begin(), data.end(), pref.begin(),
+			[](const Person& a, const Person& b) { return a.name == b.name; });
+		std::printf("Person by age  %7.1f ms  %5.2fx std::stable_sort (%zu people)%s\n",
+			ms, t_cmp / ms, m, ok ? "" : "  WRONG");
+	}
+
+	// Strings with long shared prefixes, as in a name index
+	{
+		const std::size_t m = n / 10;
+		std::vector<std::string> names;
+		names.reserve(m);
+		for (std::size_t i = 0; i < m; ++i)
+			names.push_back("Surname" + std::to_string(rng() % 2000) + ", Given" + std::to_string(rng() % 5000));
+		std::vector<std::string> sref = names;
+		double t_cmp = time_ms([&] { std::sort(sref.begin(), sref.end()); });
+
+		Container<std::string> strings{names};
+		double ms = time_ms([&] { strings.sort(); });
+		bool ok = std::equal(strings.begin(), strings.end(), sref.begin());
+		std::printf("std::string    %7.1f ms  %5.2fx std::sort (%zu names)%s\n", ms, t_cmp / ms, m, ok ? "" : "  WRONG");
+
+		std::vector<Person> people;
+		for (auto& s : names) people.push_back({s, 0});
+		Container<Person> by_name{people};
+		ms = time_ms([&] { by_name.sort_by(&Person::name); });
+		ok = std::equal(by_name.begin(), by_name.end(), sref.begin(),
+			[](const Person& p, const std::string& s) { return p.name == s; });
+		t_cmp = time_ms([&] {
+			std::sort(people.begin(), people.end(),
+				[](const Person& a, const Person& b) { return a.name < b.name; });
+		});
+		std::printf("Person by name %7.1f ms  %5.2fx std::sort%s\n", ms, t_cmp / ms, ok ? "" : "  WRONG");
+
+		std::vector<String<char>> tnames;
+		for (auto& s : names) tnames.emplace_back(s.c_str());
+		Container<String<char>> tstrings{tnames};
+		t_cmp = time_ms([&] { std::sort(tnames.begin(), tnames.end()); });
+		ms = time_ms([&] { tstrings.sort(); });
+		ok = std::equal(tstrings.begin(), tstrings.end(), sref.begin(),
+			[](const String<char>& t, const std::string& s) { return std::string(t.data()) == s; });
+		std::printf("String<char>   %7.1f ms  %5.2fx std::sort%s\n", ms, t_cmp / ms, ok ? "" : "  WRONG");
+	}
+
+	// Small batches appended between queries
+	{
+		const std::size_t base = n / 5, batch = 1000, batches = 20;
+		std::vector<std::uint64_t> eager(input.begin(), input.begin() + base);
+		Container<std::uint64_t> lazy{eager};
+		lazy.sort();
+		std::sort(eager.begin(), eager.end());
+		double t_eager = 0, t_lazy = 0;
+		for (std::size_t b = 0; b < batches; ++b) {
+			for (std::size_t i = 0; i < batch; ++i) {
+				std::uint64_t x = rng();
+				eager.push_back(x);
+				lazy.push_back(x);
+			}
+			t_eager += time_ms([&] { std::sort(eager.begin(), eager.end()); });
+			t_lazy += time_ms([&] { lazy.sort(); });
+		}
+		const auto& cl = lazy;
+		bool ok = std::equal(cl.begin(), cl.end(), eager.begin());
+		std::printf("%zu batches of %zu onto %zu: re-sort %.1f ms, incremental %.1f ms%s\n",
+			batches, batch, base, t_eager, t_lazy, ok ? "" : "  WRONG");
+
+		// Rank queries on unsorted data
+		Container<std::uint64_t> fresh{input};
+		std::uint64_t top = 0, median = 0;
+		double t_top = time_ms([&] { top = fresh.smallest(10)[9]; });
+		Container<std::uint64_t> fresh2{input};
+		double t_nth = time_ms([&] { median = fresh2.nth(n / 2); });
+		ok = top == ref[9] && median == ref[n / 2];
+		std::printf("smallest(10) %.1f ms, nth(n/2) %.1f ms, full sort %.1f ms%s\n",
+			t_top, t_nth, t_std, ok ? "" : "  WRONG");
+	}
+}
@@ -53,6 +53,8 @@ void print3(const std::ranges::range auto& container){
 		std::cout << elem << (++i == container.size() ? "\n" : ", ");
 }
 
+// Formatting into a buffer with to_chars, for any sink: BufferedPrint.cc
+
 template<std::integral T>
 auto sum(const std::vector<T>& vec) {
 	// ..
@@ -60,6 +62,15 @@ auto sum(const std::vector<T>& vec) {
 
 /* Comparing Numbers  */
 template<typename T>
+constexpr T absolute(T const a) {
+	return a < T{} ? -a : a;
+}
+
+template<typename T>
+constexpr T precision_threshold = T(0.000001);
+
+// Whole arrays at once, with relative and ULP tolerances: CloseEnough.cc
+template<typename T>
 requires std::is_floating_point_v<T>
 constexpr bool close_enough20(T a, T b)
 {
@@ -102,7 +113,7 @@ constexpr double Average(const std::vector<T>& vec) {
 }
 
 template<typename T>
-concept numeric  = std::is_integral_v<T> || std::is_floating_point<T>;
+concept numeric  = std::is_integral_v<T> || std::is_floating_point_v<T>;
 
 template<typename T>
 require numeric
@@ -117,6 +128,8 @@ constexpr double Average3(std::vector<numeric auto> const &vec) {
 	return sum / static_cast<double>(vec.size());
 }
 
+// A compensated, vectorized Average over numeric: Average.cc
+
 
 
 
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "FormatString.h"
+
+/*
+	Using Format_string
+	-------------------------------------
+	The checks in FormatString.h run while compiling; each
+	of these lines stops compilation:
+
+	    format_to(b, e, "%d and %d", 1);          // format_error_too_few_arguments
+	    format_to(b, e, "%d", 1, 2);              // format_error_too_many_arguments
+	    format_to(b, e, "%s", 42);                // format_error_conversion_does_not_match_argument
+	    format_to(b, e, "%.2d", 42);              // format_error_precision_needs_f_e_or_g
+	    format_to(b, e, "100%", 1);               // format_error_missing_conversion
+
+	Below, the same log line is formatted by the variadic
+	printf of TemplateMetaprogramming.cc (on a string stream),
+	by std::snprintf, which also parses at run time, and by
+	format_to.
+*/
+
+// The version in TemplateMetaprogramming.cc, on any stream
+void stream_printf(std::ostream& os, const char* s)
+{
+	if (s == nullptr) return;
+	while (*s) {
+		if (*s == '%' && *++s != '%')
+			throw std::runtime_error("Invalid format: missing arguments");
+		os << *s++;
+	}
+}
+
+template<typename T, typename... Args>
+void stream_printf(std::ostream& os, const char* s, T value, Args... args)
+{
+	while (s && *s) {
+		if (*s == '%' && *++s != '%') {
+			os << value;
+			return stream_printf(os, ++s, args...);
+		}
+		os << *s++;
+	}
+	throw std::runtime_error("extra arguments provided to printf");
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	std::string user = "alice";
+	int x = 255;
+	print(stdout, "%d%% of %s: %x, %c, %.2f, %e, %g, %s\n", 42, user, x, 'z', 3.14159, 1e-7, 0.5, "done");
+	print(stdout, "pointer %p, no arguments, long %s\n", static_cast<const void*>(&x), std::string(600, '.'));
+
+	char small[8];
+	auto r = format_to(small, small + sizeof small, "%d-%d", 12345, 67890);
+	std::printf("into 8 chars: %s, kept \"%.*s\"\n", r.ec == std::errc::value_too_large ? "too small" : "fits",
+		int(r.ptr - small), small);
+
+	const int lines = argc > 1 ? std::atoi(argv[1]) : 2'000'000;
+	const char* path = "/api/v1/items";
+	std::size_t bytes1 = 0, bytes2 = 0, bytes3 = 0;
+	char buf[256];
+	std::ostringstream os;
+	double t1 = time_ms([&] {
+		for (int i = 0; i < lines; ++i) {
+			os.str({});
+			stream_printf(os, "request % from % took % ms, status %\n", i, path, i * 0.001, 200);
+			bytes1 += os.view().size();
+		}
+	});
+	double t2 = time_ms([&] {
+		for (int i = 0; i < lines; ++i)
+			bytes2 += std::size_t(std::snprintf(buf, sizeof buf, "request %d from %s took %.3f ms, status %d\n", i, path, i * 0.001, 200));
+	});
+	double t3 = time_ms([&] {
+		for (int i = 0; i < lines; ++i)
+			bytes3 += std::size_t(format_to(buf, buf + sizeof buf, "request %d from %s took %.3f ms, status %d\n", i, path, i * 0.001, 200).ptr - buf);
+	});
+	std::printf("%d lines\n", lines);
+	std::printf("stream printf %8.1f ms %6.1f ns/line  (%zu bytes)\n", t1, t1 * 1e6 / lines, bytes1);
+	std::printf("snprintf      %8.1f ms %6.1f ns/line  (%zu bytes)\n", t2, t2 * 1e6 / lines, bytes2);
+	std::printf("format_to     %8.1f ms %6.1f ns/line  (%zu bytes)  %.2fx snprintf\n", t3, t3 * 1e6 / lines, bytes3, t2 / t3);
+}
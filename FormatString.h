@@ -0,0 +1,251 @@
+#ifndef FORMAT_STRING_H
+#define FORMAT_STRING_H
+
+/*
+	Checked, Pre-parsed Format Strings
+	-------------------------------------
+	The variadic printf() of TemplateMetaprogramming.cc walks
+	the format string at run time, character by character,
+	on every call, and finds out only then (by throwing)
+	that the arguments don't match it. Yet the format string
+	is almost always a literal: everything about it is known
+	at compile time.
+
+	Format_string<Args...> is built from the literal by a
+	consteval constructor, so the parsing happens during
+	compilation:
+
+	- the text is cut into pieces: a run of literal text
+	  (given by its offset and length in the literal),
+	  followed by the conversion of the next argument or by
+	  nothing;
+	- the number of conversions must equal the number of
+	  arguments, and each conversion must suit its
+	  argument's type; otherwise compilation stops, naming
+	  one of the format_error_ functions below.
+
+	format_to(first, last, fmt, args...) then only follows
+	the pieces: copy a literal, format an argument with
+	std::to_chars, and so on. It doesn't look at the format
+	string's characters, allocate or throw; like to_chars it
+	returns the end of the output, or errc::value_too_large
+	if [first, last) was too small.
+
+	Conversions (% followed by):
+
+	    d i u   any integer (or char), by its value
+	    x       any integer, in hex (of its unsigned value)
+	    c       char
+	    f e g   floating point, fixed, scientific or general,
+	            with an optional precision: %.3f (default 6)
+	    s       C string, std::string, std::string_view
+	    p       pointer, as 0x followed by hex
+	    %%      a % sign
+
+	There are no widths or flags. Arguments are taken in
+	order, as by printf. A format string can be up to 64 KB
+	long and hold up to max_escapes %% sequences. The
+	Format_string is small and trivially copyable, so it can
+	be kept for formatting later (see AsyncLog.cc).
+*/
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+// Never defined: reached only while checking a bad format string, they stop compilation by name
+void format_error_missing_conversion();
+void format_error_too_few_arguments();
+void format_error_too_many_arguments();
+void format_error_conversion_does_not_match_argument();
+void format_error_precision_needs_f_e_or_g();
+void format_error_too_many_percent_escapes();
+void format_error_format_string_too_long();
+
+// Literal text, then the next argument unless conversion is 0
+struct Format_piece {
+	std::uint16_t begin = 0;	// the text is [begin, begin + size) of the format string
+	std::uint16_t size = 0;
+	char conversion = 0;
+	std::uint8_t precision = 6;
+};
+
+// The conversions an argument of type T may use
+template<typename T>
+consteval std::string_view conversions_for()
+{
+	using U = std::remove_cv_t<std::decay_t<T>>;
+	if constexpr (std::same_as<U, char>)
+		return "cdiux";
+	else if constexpr (std::integral<U>)
+		return "diux";
+	else if constexpr (std::floating_point<U>)
+		return "feg";
+	else if constexpr (std::same_as<U, const char*> || std::same_as<U, char*>)
+		return "sp";
+	else if constexpr (std::convertible_to<const U&, std::string_view>)
+		return "s";
+	else if constexpr (std::is_pointer_v<U>)
+		return "p";
+	else
+		return "";
+}
+
+constexpr std::size_t max_escapes = 8;
+
+template<typename... Args>
+class Format_string {
+public:
+	consteval Format_string(const char* s) : text{s}
+	{
+		constexpr std::string_view accepted[] = {conversions_for<Args>()..., ""};
+		const std::size_t n = std::char_traits<char>::length(s);
+		if (n > 0xffff) format_error_format_string_too_long();
+		std::size_t arg = 0, begin = 0, escapes = 0;
+		for (std::size_t i = 0; i < n; ++i) {
+			if (s[i] != '%') continue;
+			if (i + 1 == n) format_error_missing_conversion();
+			Format_piece p{std::uint16_t(begin), std::uint16_t(i - begin)};
+			if (s[i + 1] == '%') {
+				// The literal ends with the first %; the second is skipped
+				if (++escapes > max_escapes) format_error_too_many_percent_escapes();
+				p.size += 1;
+				pieces[count++] = p;
+				begin = ++i + 1;
+				continue;
+			}
+			if (s[++i] == '.') {
+				unsigned precision = 0;
+				while (++i < n && s[i] >= '0' && s[i] <= '9')
+					precision = precision * 10 + unsigned(s[i] - '0');
+				if (i == n) format_error_missing_conversion();
+				if (s[i] != 'f' && s[i] != 'e' && s[i] != 'g') format_error_precision_needs_f_e_or_g();
+				p.precision = std::uint8_t(precision < 60 ? precision : 60);
+			}
+			if (arg == sizeof...(Args)) format_error_too_few_arguments();
+			if (accepted[arg].find(s[i]) == std::string_view::npos) format_error_conversion_does_not_match_argument();
+			p.conversion = s[i];
+			pieces[count++] = p;
+			++arg;
+			begin = i + 1;
+		}
+		if (arg != sizeof...(Args)) format_error_too_many_arguments();
+		pieces[count++] = Format_piece{std::uint16_t(begin), std::uint16_t(n - begin)};
+	}
+
+	// The arguments, or stand-ins of the same kind (a string_view for a std::string)
+	template<typename... Ts>
+	requires (sizeof...(Ts) == sizeof...(Args))
+	std::to_chars_result format(char* first, char* last, const Ts&... args) const
+	{
+		std::size_t p = 0;
+		bool ok = true;
+		auto literal = [&](const Format_piece& f) {
+			if (!ok) return;
+			if (std::size_t(last - first) < f.size) {
+				ok = false;
+				return;
+			}
+			std::memcpy(first, text + f.begin, f.size);
+			first += f.size;
+		};
+		auto next = [&](const auto& a) {
+			for (; literal(pieces[p]), pieces[p].conversion == 0; ++p) {}
+			if (ok) ok = put_arg(first, last, pieces[p], a);
+			++p;
+		};
+		(next(args), ...);
+		for (; p < count; ++p)
+			literal(pieces[p]);
+		return {first, ok ? std::errc{} : std::errc::value_too_large};
+	}
+
+	const char* c_str() const { return text; }
+
+private:
+	template<typename T>
+	static bool put_arg(char*& first, char* last, const Format_piece& f, const T& a)
+	{
+		using U = std::remove_cv_t<std::decay_t<T>>;
+		std::to_chars_result r;
+		if constexpr (std::same_as<U, char>) {
+			if (f.conversion != 'c') return put_arg(first, last, f, int(a));
+			if (first == last) return false;
+			*first++ = a;
+			return true;
+		} else if constexpr (std::same_as<U, bool>) {
+			return put_arg(first, last, f, int(a));
+		} else if constexpr (std::integral<U>) {
+			r = f.conversion == 'x' ? std::to_chars(first, last, std::make_unsigned_t<U>(a), 16) : std::to_chars(first, last, a);
+		} else if constexpr (std::floating_point<U>) {
+			auto form = f.conversion == 'f' ? std::chars_format::fixed
+				: f.conversion == 'e' ? std::chars_format::scientific : std::chars_format::general;
+			r = std::to_chars(first, last, a, form, f.precision);
+		} else if constexpr (std::is_pointer_v<U> && !std::convertible_to<U, std::string_view>) {
+			return put_pointer(first, last, a);
+		} else {
+			if constexpr (std::is_pointer_v<U>) {
+				if (f.conversion == 'p') return put_pointer(first, last, a);
+				if constexpr (std::is_pointer_v<std::remove_cvref_t<T>>)
+					if (a == nullptr) return put_text(first, last, "(null)");
+			}
+			return put_text(first, last, std::string_view{a});
+		}
+		if (r.ec != std::errc{}) return false;
+		first = r.ptr;
+		return true;
+	}
+
+	static bool put_text(char*& first, char* last, std::string_view s)
+	{
+		if (std::size_t(last - first) < s.size()) return false;
+		std::memcpy(first, s.data(), s.size());
+		first += s.size();
+		return true;
+	}
+
+	static bool put_pointer(char*& first, char* last, const void* p)
+	{
+		if (last - first < 2) return false;
+		*first++ = '0';
+		*first++ = 'x';
+		auto r = std::to_chars(first, last, reinterpret_cast<std::uintptr_t>(p), 16);
+		first = r.ptr;
+		return r.ec == std::errc{};
+	}
+
+	const char* text;
+	std::uint32_t count = 0;
+	Format_piece pieces[sizeof...(Args) + 1 + max_escapes] = {};
+};
+
+template<typename... Args>
+std::to_chars_result format_to(char* first, char* last, Format_string<std::type_identity_t<Args>...> fmt, const Args&... args)
+{
+	return fmt.format(first, last, args...);
+}
+
+// Formats on the stack (on the heap if the line is long) and writes with one fwrite
+template<typename... Args>
+void print(std::FILE* f, Format_string<std::type_identity_t<Args>...> fmt, const Args&... args)
+{
+	char line[512];
+	auto r = fmt.format(line, line + sizeof line, args...);
+	if (r.ec == std::errc{}) {
+		std::fwrite(line, 1, std::size_t(r.ptr - line), f);
+		return;
+	}
+	std::vector<char> big(4 * sizeof line);
+	while ((r = fmt.format(big.data(), big.data() + big.size(), args...)).ec != std::errc{})
+		big.resize(2 * big.size());
+	std::fwrite(big.data(), 1, std::size_t(r.ptr - big.data()), f);
+}
+
+#endif
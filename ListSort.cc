@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+/*
+	Sorting a Linked List
+	-------------------------------------
+	Template_Instantiation.cc declares List<T>::sort() and
+	only uses it to show that members are instantiated on
+	demand. Here it is defined.
+
+	A list can't be sorted with std::sort (no random
+	access), but it doesn't need to move elements either:
+	sorting is just relinking nodes.
+
+	sort() is a natural bottom-up merge sort:
+
+	1. The list is cut into runs that are already in order
+	   (a strictly descending run is reversed, which keeps
+	   the sort stable).
+	2. Runs are merged like a binary counter: pending[k]
+	   holds the merge of 2^k runs. At most 64 pending
+	   lists, so no memory is allocated.
+	3. Merging takes from the left list on ties, so equal
+	   elements keep their order: the sort is stable.
+
+	O(n log r) comparisons for r initial runs; sorted input
+	costs one pass.
+
+	Each merge step chases next pointers across the heap.
+	For long lists it can pay to gather node pointers into
+	an array, sort the array and relink once; that mode
+	allocates, so it is opt-in (Sort_mode::gather), or
+	chosen above a size threshold with Sort_mode::automatic.
+*/
+
+enum class Sort_mode { in_place, gather, automatic };
+
+template<typename T>
+struct Node {
+	Node* next;
+	T value;
+};
+
+template<typename T>
+class List {
+public:
+	List() = default;
+	List(const List&) = delete;
+	List& operator=(const List&) = delete;
+	List(List&& o) noexcept : head{o.head}, tail{o.tail}, count{o.count}
+	{
+		o.head = o.tail = nullptr;
+		o.count = 0;
+	}
+	~List() { clear(); }
+
+	void push_back(const T& v)
+	{
+		Node<T>* n = new Node<T>{nullptr, v};
+		if (tail) tail->next = n;
+		else head = n;
+		tail = n;
+		++count;
+	}
+
+	void push_front(const T& v)
+	{
+		head = new Node<T>{head, v};
+		if (!tail) tail = head;
+		++count;
+	}
+
+	void clear()
+	{
+		while (head) {
+			Node<T>* n = head->next;
+			delete head;
+			head = n;
+		}
+		tail = nullptr;
+		count = 0;
+	}
+
+	std::size_t size() const { return count; }
+	Node<T>* first() const { return head; }
+
+	template<typename F>
+	void for_each(F f) const
+	{
+		for (Node<T>* p = head; p; p = p->next) f(p->value);
+	}
+
+	static constexpr std::size_t gather_threshold = 1 << 16;
+
+	template<typename Compare = std::less<T>>
+	void sort(Compare cmp = {}, Sort_mode mode = Sort_mode::in_place)
+	{
+		if (count < 2) return;
+		if (mode == Sort_mode::gather
+			|| (mode == Sort_mode::automatic && count >= gather_threshold))
+			gather_sort(cmp);
+		else
+			merge_sort(cmp);
+	}
+
+private:
+	Node<T>* head = nullptr;
+	Node<T>* tail = nullptr;
+	std::size_t count = 0;
+
+	// Stable: on ties the node from a (the earlier one) goes first
+	template<typename Compare>
+	static Node<T>* merge(Node<T>* a, Node<T>* b, Compare& cmp)
+	{
+		Node<T>* h = nullptr;
+		Node<T>** t = &h;
+		while (a && b) {
+			if (cmp(b->value, a->value)) { *t = b; b = b->next; }
+			else { *t = a; a = a->next; }
+			t = &(*t)->next;
+		}
+		*t = a ? a : b;
+		return h;
+	}
+
+	// Detaches the run starting at p; returns it and advances p
+	template<typename Compare>
+	static Node<T>* take_run(Node<T>*& p, Compare& cmp)
+	{
+		Node<T>* run = p;
+		Node<T>* last = p;
+		Node<T>* q = p->next;
+		if (q && cmp(q->value, last->value)) {
+			// strictly descending: reverse while collecting
+			last->next = nullptr;
+			while (q && cmp(q->value, run->value)) {
+				Node<T>* nx = q->next;
+				q->next = run;
+				run = q;
+				q = nx;
+			}
+		}
+		else {
+			while (q && !cmp(q->value, last->value)) {
+				last = q;
+				q = q->next;
+			}
+			last->next = nullptr;
+		}
+		p = q;
+		return run;
+	}
+
+	template<typename Compare>
+	void merge_sort(Compare& cmp)
+	{
+		Node<T>* pending[64] = {};
+		Node<T>* p = head;
+		while (p) {
+			Node<T>* run = take_run(p, cmp);
+			int k = 0;
+			for (; pending[k]; ++k) {
+				run = merge(pending[k], run, cmp);
+				pending[k] = nullptr;
+			}
+			pending[k] = run;
+		}
+		Node<T>* result = nullptr;
+		for (Node<T>* part : pending)
+			if (part) result = result ? merge(part, result, cmp) : part;
+		relink_tail(result);
+	}
+
+	template<typename Compare>
+	void gather_sort(Compare& cmp)
+	{
+		std::vector<Node<T>*> nodes;
+		nodes.reserve(count);
+		for (Node<T>* p = head; p; p = p->next) nodes.push_back(p);
+		std::stable_sort(nodes.begin(), nodes.end(),
+			[&cmp](const Node<T>* a, const Node<T>* b) { return cmp(a->value, b->value); });
+		for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+			nodes[i]->next = nodes[i + 1];
+		nodes.back()->next = nullptr;
+		head = nodes.front();
+		tail = nodes.back();
+	}
+
+	void relink_tail(Node<T>* h)
+	{
+		head = h;
+		tail = h;
+		while (tail->next) tail = tail->next;
+	}
+};
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+struct Item {
+	int key;
+	int seq;
+};
+
+template<typename Fill>
+void bench(const char* label, int n, Fill fill)
+{
+	auto by_key = [](const Item& a, const Item& b) { return a.key < b.key; };
+	std::vector<Item> input(n);
+	fill(input);
+	for (int i = 0; i < n; ++i) input[i].seq = i;
+	auto make = [&] {
+		List<Item> l;
+		for (auto& x : input) l.push_back(x);
+		return l;
+	};
+	auto check = [&](const List<Item>& l) {
+		bool ok = true;
+		const Item* prev = nullptr;
+		l.for_each([&](const Item& x) {
+			if (prev && (x.key < prev->key || (x.key == prev->key && x.seq < prev->seq)))
+				ok = false;
+			prev = &x;
+		});
+		return ok;
+	};
+
+	List<Item> a = make(), b = make(), c = make();
+	double t_in_place = time_ms([&] { a.sort(by_key); });
+	double t_gather = time_ms([&] { b.sort(by_key, Sort_mode::gather); });
+	double t_vector = time_ms([&] {
+		// The usual workaround: copy out, sort, copy back
+		std::vector<Item> v;
+		v.reserve(c.size());
+		c.for_each([&](const Item& x) { v.push_back(x); });
+		std::stable_sort(v.begin(), v.end(), by_key);
+		std::size_t i = 0;
+		for (Node<Item>* p = c.first(); p; p = p->next) p->value = v[i++];
+	});
+	std::printf("%-14s in-place %8.2f ms  gather %8.2f ms  vector %8.2f ms%s\n",
+		label, t_in_place, t_gather, t_vector,
+		check(a) && check(b) && check(c) ? "" : "  NOT SORTED");
+}
+
+int main(int argc, char* argv[])
+{
+	List<int> l;
+	for (int x : {5, 3, 9, 1, 3, 7}) l.push_back(x);
+	l.sort();
+	l.for_each([](int x) { std::printf("%d ", x); });
+	l.sort(std::greater<int>{});
+	l.for_each([](int x) { std::printf("%d ", x); });
+	std::printf("\n");
+
+	const int n = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	std::mt19937 rng{17};
+	bench("random", n, [&](std::vector<Item>& v) {
+		for (auto& x : v) x.key = int(rng() % n);
+	});
+	bench("few keys", n, [&](std::vector<Item>& v) {
+		for (auto& x : v) x.key = int(rng() % 16);
+	});
+	bench("sorted", n, [&](std::vector<Item>& v) {
+		for (int i = 0; i < n; ++i) v[i].key = i;
+	});
+	bench("reversed", n, [&](std::vector<Item>& v) {
+		for (int i = 0; i < n; ++i) v[i].key = n - i;
+	});
+	bench("sorted runs", n, [&](std::vector<Item>& v) {
+		for (int i = 0; i < n; ++i) v[i].key = i % 1000 + int(rng() % 4);
+	});
+}
@@ -0,0 +1,427 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+	A Lock-Free Sorted List (Harris-Michael)
+	-------------------------------------------
+	A List<T> behind a mutex lets one thread in at a time;
+	the registry threads spend their time waiting for the
+	lock instead of walking the list.
+
+	Harris' lock-free list keeps the Node<T> shape of
+	Template_Instantiation.cc, a value and a next pointer,
+	and updates links only with compare-and-swap (CAS):
+
+	1. Insert: find the position, then CAS the predecessor's
+	   next from the successor to the new node.
+	2. Erase happens in two steps. Logical deletion sets
+	   the low bit of the victim's own next pointer (nodes
+	   are aligned, so the bit is free): from then on no CAS
+	   can link anything after it. Physical deletion then
+	   CASes the predecessor past it; any thread that meets
+	   a marked node helps unlink it (Michael's variant).
+	3. contains() never writes and never retries: it walks
+	   forward until the key, so it is wait-free.
+
+	A node unlinked by one thread may still be read by
+	another, so it can't be deleted right away. Epoch-based
+	reclamation defers the delete: every operation runs
+	inside an epoch guard announcing the global epoch it
+	saw; the epoch advances only when all active threads
+	have seen the current one, and a node retired in epoch
+	e is freed once the global epoch reaches e + 2, when no
+	thread can still hold a pointer to it.
+*/
+
+class Epoch_domain {
+	struct alignas(64) Slot {
+		std::atomic<std::uint64_t> state{0};	// epoch << 1 | active
+		std::atomic<bool> used{false};
+	};
+	struct Local;
+
+public:
+	static constexpr int max_threads = 256;
+
+	static Epoch_domain& instance()
+	{
+		static Epoch_domain d;
+		return d;
+	}
+
+	// Guards nest: only the outermost one announces an epoch
+	// and only its exit ends the critical section.
+	class Guard {
+	public:
+		Guard() : l{local()}
+		{
+			if (l.depth++ > 0) return;
+			std::uint64_t e = instance().global.load(std::memory_order_relaxed);
+			l.slot->state.store(e << 1 | 1, std::memory_order_seq_cst);
+		}
+		~Guard()
+		{
+			if (--l.depth == 0) l.slot->state.store(0, std::memory_order_release);
+		}
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+	private:
+		Local& l;
+	};
+
+	// Call inside a Guard, after p has been unlinked
+	void retire(void* p, void (*del)(void*))
+	{
+		Local& l = local();
+		l.limbo.push_back({p, del, global.load(std::memory_order_acquire)});
+		if (++l.retired % 64 == 0) {
+			try_advance();
+			collect(l.limbo);
+			// Left behind by threads that exited
+			if (std::unique_lock lock{orphans_m, std::try_to_lock}; lock && !orphans.empty())
+				collect(orphans);
+		}
+	}
+
+	~Epoch_domain()
+	{
+		for (auto& r : orphans) r.del(r.p);
+	}
+
+private:
+	struct Retired {
+		void* p;
+		void (*del)(void*);
+		std::uint64_t epoch;
+	};
+
+	// Per-thread: a claimed slot and the nodes it retired
+	struct Local {
+		Slot* slot = nullptr;
+		std::vector<Retired> limbo;
+		unsigned retired = 0;
+		int depth = 0;	// Guards open on this thread
+
+		Local()
+		{
+			Epoch_domain& d = instance();
+			for (auto& s : d.slots) {
+				bool f = false;
+				if (s.used.compare_exchange_strong(f, true)) { slot = &s; return; }
+			}
+			std::abort(); // more than max_threads threads
+		}
+		~Local()
+		{
+			Epoch_domain& d = instance();
+			std::lock_guard lock{d.orphans_m};
+			d.orphans.insert(d.orphans.end(), limbo.begin(), limbo.end());
+			slot->used.store(false, std::memory_order_release);
+		}
+	};
+
+	static Local& local()
+	{
+		thread_local Local l;
+		return l;
+	}
+
+	void try_advance()
+	{
+		std::uint64_t e = global.load(std::memory_order_seq_cst);
+		for (auto& s : slots) {
+			std::uint64_t st = s.state.load(std::memory_order_seq_cst);
+			if ((st & 1) && (st >> 1) != e) return;
+		}
+		global.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+	}
+
+	void collect(std::vector<Retired>& limbo)
+	{
+		std::uint64_t g = global.load(std::memory_order_acquire);
+		std::size_t done = 0;
+		while (done < limbo.size() && limbo[done].epoch + 2 <= g) {
+			limbo[done].del(limbo[done].p);
+			++done;
+		}
+		limbo.erase(limbo.begin(), limbo.begin() + done);
+	}
+
+	std::atomic<std::uint64_t> global{0};
+	Slot slots[max_threads];
+	std::mutex orphans_m;
+	std::vector<Retired> orphans;
+};
+
+template<typename T>
+struct alignas(2) Node {
+	std::atomic<std::uintptr_t> next;	// low bit: logically deleted
+	T value;
+};
+
+template<typename T, typename Compare = std::less<T>>
+class Lock_free_list {
+	using link = std::atomic<std::uintptr_t>;
+
+	static Node<T>* ptr(std::uintptr_t p) { return reinterpret_cast<Node<T>*>(p & ~std::uintptr_t{1}); }
+	static bool marked(std::uintptr_t p) { return p & 1; }
+	static std::uintptr_t bits(Node<T>* n) { return reinterpret_cast<std::uintptr_t>(n); }
+
+public:
+	Lock_free_list() = default;
+	explicit Lock_free_list(Compare c) : cmp{std::move(c)} {}
+	Lock_free_list(const Lock_free_list&) = delete;
+	Lock_free_list& operator=(const Lock_free_list&) = delete;
+
+	// Only when no other thread uses the list any more
+	~Lock_free_list()
+	{
+		for (Node<T>* n = ptr(head.load()); n; ) {
+			Node<T>* nx = ptr(n->next.load());
+			delete n;
+			n = nx;
+		}
+	}
+
+	bool insert(const T& v)
+	{
+		Epoch_domain::Guard g;
+		Node<T>* n = nullptr;
+		for (;;) {
+			auto [prev, curr] = find(v);
+			if (curr && !cmp(v, curr->value)) {
+				delete n;
+				return false;
+			}
+			if (!n) n = new Node<T>{{0}, v};
+			n->next.store(bits(curr), std::memory_order_relaxed);
+			std::uintptr_t expected = bits(curr);
+			if (prev->compare_exchange_strong(expected, bits(n),
+					std::memory_order_release, std::memory_order_relaxed))
+				return true;
+		}
+	}
+
+	bool erase(const T& v)
+	{
+		Epoch_domain::Guard g;
+		for (;;) {
+			auto [prev, curr] = find(v);
+			if (!curr || cmp(v, curr->value)) return false;
+			std::uintptr_t succ = curr->next.load(std::memory_order_acquire);
+			if (marked(succ)) continue;
+			// Logical deletion
+			if (!curr->next.compare_exchange_strong(succ, succ | 1,
+					std::memory_order_acq_rel, std::memory_order_relaxed))
+				continue;
+			// Physical deletion; on failure find() helps
+			std::uintptr_t expected = bits(curr);
+			if (prev->compare_exchange_strong(expected, succ,
+					std::memory_order_acq_rel, std::memory_order_relaxed))
+				retire(curr);
+			else
+				find(v);
+			return true;
+		}
+	}
+
+	// Wait-free: no helping, no retries
+	bool contains(const T& v) const
+	{
+		Epoch_domain::Guard g;
+		Node<T>* c = ptr(head.load(std::memory_order_acquire));
+		while (c && cmp(c->value, v))
+			c = ptr(c->next.load(std::memory_order_acquire));
+		return c && !cmp(v, c->value) && !marked(c->next.load(std::memory_order_acquire));
+	}
+
+	// Not linearizable against concurrent updates; for checks and reports
+	template<typename F>
+	void for_each(F f) const
+	{
+		Epoch_domain::Guard g;
+		for (Node<T>* c = ptr(head.load(std::memory_order_acquire)); c; ) {
+			std::uintptr_t nx = c->next.load(std::memory_order_acquire);
+			if (!marked(nx)) f(c->value);
+			c = ptr(nx);
+		}
+	}
+
+private:
+	struct Position {
+		link* prev;
+		Node<T>* curr;
+	};
+
+	// First node not less than v, and the link pointing to it;
+	// unlinks marked nodes on the way.
+	Position find(const T& v)
+	{
+	retry:
+		link* prev = &head;
+		std::uintptr_t curr = prev->load(std::memory_order_acquire);
+		for (;;) {
+			Node<T>* c = ptr(curr);
+			if (!c) return {prev, nullptr};
+			std::uintptr_t succ = c->next.load(std::memory_order_acquire);
+			if (marked(succ)) {
+				std::uintptr_t expected = curr;
+				if (!prev->compare_exchange_strong(expected, succ & ~std::uintptr_t{1},
+						std::memory_order_acq_rel, std::memory_order_acquire))
+					goto retry;
+				retire(c);
+				curr = succ & ~std::uintptr_t{1};
+				continue;
+			}
+			if (!cmp(c->value, v)) return {prev, c};
+			prev = &c->next;
+			curr = succ;
+		}
+	}
+
+	static void retire(Node<T>* n)
+	{
+		Epoch_domain::instance().retire(n, [](void* p) { delete static_cast<Node<T>*>(p); });
+	}
+
+	link head{0};
+	[[no_unique_address]] Compare cmp {};
+};
+
+// The baseline: a sorted singly linked list behind one mutex
+template<typename T>
+class Locked_list {
+	struct Plain { Plain* next; T value; };
+public:
+	~Locked_list() { while (head) { Plain* n = head->next; delete head; head = n; } }
+	bool insert(const T& v)
+	{
+		std::lock_guard lock{m};
+		Plain** p = &head;
+		while (*p && (*p)->value < v) p = &(*p)->next;
+		if (*p && !(v < (*p)->value)) return false;
+		*p = new Plain{*p, v};
+		return true;
+	}
+	bool erase(const T& v)
+	{
+		std::lock_guard lock{m};
+		Plain** p = &head;
+		while (*p && (*p)->value < v) p = &(*p)->next;
+		if (!*p || v < (*p)->value) return false;
+		Plain* victim = *p;
+		*p = victim->next;
+		delete victim;
+		return true;
+	}
+	bool contains(const T& v) const
+	{
+		std::lock_guard lock{m};
+		Plain* p = head;
+		while (p && p->value < v) p = p->next;
+		return p && !(v < p->value);
+	}
+private:
+	mutable std::mutex m;
+	Plain* head = nullptr;
+};
+
+template<typename F>
+void run_threads(int threads, F f)
+{
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t) pool.emplace_back(f, t);
+	for (auto& th : pool) th.join();
+}
+
+/*
+	Stress test: threads hammer a small key range; each thread
+	counts its successful inserts and erases per key. At the
+	end, for every key, inserts - erases must be 1 if the key
+	is in the list and 0 if not, and the list must be sorted.
+*/
+bool stress(int threads, int ops)
+{
+	constexpr int keys = 64;
+	Lock_free_list<int> list;
+	std::vector<std::vector<long>> net(threads, std::vector<long>(keys));
+	run_threads(threads, [&](int t) {
+		std::mt19937 rng(t * 7 + 1);
+		for (int i = 0; i < ops; ++i) {
+			int k = int(rng() % keys);
+			switch (rng() % 3) {
+			case 0: net[t][k] += list.insert(k); break;
+			case 1: net[t][k] -= list.erase(k); break;
+			default: list.contains(k); break;
+			}
+		}
+	});
+	bool ok = true;
+	int prev = -1;
+	std::vector<bool> present(keys);
+	list.for_each([&](int k) {
+		ok &= k > prev;
+		prev = k;
+		present[k] = true;
+	});
+	for (int k = 0; k < keys; ++k) {
+		long sum = 0;
+		for (int t = 0; t < threads; ++t) sum += net[t][k];
+		ok &= sum == (present[k] ? 1 : 0) && present[k] == list.contains(k);
+	}
+	return ok;
+}
+
+template<typename List>
+double throughput(int threads, int ops, int keys)
+{
+	List list;
+	for (int k = 0; k < keys; k += 2) list.insert(k);
+	auto t0 = std::chrono::steady_clock::now();
+	run_threads(threads, [&](int t) {
+		std::mt19937 rng(t + 1);
+		for (int i = 0; i < ops; ++i) {
+			int k = int(rng() % keys);
+			unsigned op = rng() % 100;
+			if (op < 10) list.insert(k);
+			else if (op < 20) list.erase(k);
+			else list.contains(k);
+		}
+	});
+	auto t1 = std::chrono::steady_clock::now();
+	return threads * double(ops) / std::chrono::duration<double>(t1 - t0).count() / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+	const int max_threads = argc > 1 ? std::atoi(argv[1])
+		: int(std::max(16u, std::thread::hardware_concurrency()));
+	const int ops = argc > 2 ? std::atoi(argv[2]) : 400'000;
+	const int keys = 512;
+
+	Lock_free_list<int, std::greater<int>> down;
+	for (int x : {3, 1, 4, 1, 5, 9, 2, 6}) down.insert(x);
+	down.erase(4);
+	down.for_each([](int x) { std::printf("%d ", x); });
+	std::printf("\n");
+
+	std::printf("stress (%d threads): %s\n", max_threads,
+		stress(max_threads, ops / 4) ? "ok" : "FAILED");
+
+	std::printf("10%% insert / 10%% erase / 80%% contains over %d keys\n", keys);
+	std::printf("threads  mutex Mops/s  lock-free Mops/s\n");
+	for (int t = 1; t <= max_threads; t *= 2) {
+		double a = throughput<Locked_list<int>>(t, ops / t, keys);
+		double b = throughput<Lock_free_list<int>>(t, ops / t, keys);
+		std::printf("%7d  %12.2f  %16.2f\n", t, a, b);
+	}
+	std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+}
@@ -0,0 +1,157 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+/*
+	Node Pools
+	-------------------------------------
+	Node based containers (std::set, std::map, std::list)
+	ask the allocator for one node at a time. With the
+	default allocator every insert is a separate malloc,
+	so neighbouring nodes end up scattered over the heap.
+
+	Slab_pool carves nodes out of large contiguous slabs
+	and recycles freed nodes through a free list per size
+	class. Pool_allocator<T> is the allocator policy that
+	plugs it into a container. Each default-constructed
+	Pool_allocator owns a fresh pool, so a container gets
+	its own pool; rebound copies (set<T> allocates nodes,
+	not Ts) share it.
+
+	Releasing the memory of a whole container is one free
+	per slab. Element destructors still run per node.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+class Slab_pool {
+public:
+	explicit Slab_pool(std::size_t first_slab = 16 * 1024)
+		: next_slab{first_slab} {}
+	Slab_pool(const Slab_pool&) = delete;
+	Slab_pool& operator=(const Slab_pool&) = delete;
+	~Slab_pool() { release(); }
+
+	void* allocate(std::size_t bytes, std::size_t align)
+	{
+		if (bytes > max_pooled || align > granule)
+			return ::operator new(bytes, std::align_val_t{align});
+		std::size_t c = size_class(bytes);
+		if (Free* f = free_list[c]) {
+			free_list[c] = f->next;
+			return f;
+		}
+		std::size_t sz = (c + 1) * granule;
+		if (std::size_t(end - cur) < sz) grow();
+		void* p = cur;
+		cur += sz;
+		return p;
+	}
+
+	void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept
+	{
+		if (bytes > max_pooled || align > granule) {
+			::operator delete(p, std::align_val_t{align});
+			return;
+		}
+		std::size_t c = size_class(bytes);
+		free_list[c] = new(p) Free{free_list[c]};
+	}
+
+	// Drops every slab at once: O(slabs), not O(nodes).
+	void release() noexcept
+	{
+		for (void* s : slabs) ::operator delete(s);
+		slabs.clear();
+		std::fill(std::begin(free_list), std::end(free_list), nullptr);
+		cur = end = nullptr;
+	}
+
+	std::size_t slab_count() const { return slabs.size(); }
+
+private:
+	static constexpr std::size_t granule = alignof(std::max_align_t);
+	static constexpr std::size_t classes = 16;
+	static constexpr std::size_t max_pooled = granule * classes;
+	static constexpr std::size_t max_slab = 1024 * 1024;
+
+	struct Free { Free* next; };
+
+	static std::size_t size_class(std::size_t bytes)
+	{
+		return bytes ? (bytes - 1) / granule : 0;
+	}
+
+	void grow()
+	{
+		// Whatever is left of the old slab is abandoned;
+		// it is at most one node's worth.
+		slabs.reserve(slabs.size() + 1);
+		cur = static_cast<char*>(::operator new(next_slab));
+		end = cur + next_slab;
+		slabs.push_back(cur);
+		next_slab = std::min(next_slab * 2, max_slab);
+	}
+
+	Free* free_list[classes] {};
+	std::vector<void*> slabs;
+	char* cur = nullptr;
+	char* end = nullptr;
+	std::size_t next_slab;
+};
+
+template<typename T>
+class Pool_allocator {
+public:
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	Pool_allocator() : pool{std::make_shared<Slab_pool>()} {}
+
+	// Moving copies: a moved-from allocator (and the container left holding it) must keep its pool
+	Pool_allocator(const Pool_allocator&) noexcept = default;
+	Pool_allocator(Pool_allocator&& other) noexcept : pool{other.pool} {}
+	Pool_allocator& operator=(const Pool_allocator&) noexcept = default;
+	Pool_allocator& operator=(Pool_allocator&& other) noexcept
+	{
+		pool = other.pool;
+		return *this;
+	}
+
+	template<typename U>
+	Pool_allocator(const Pool_allocator<U>& other) noexcept : pool{other.pool} {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(pool->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		pool->deallocate(p, n * sizeof(T), alignof(T));
+	}
+
+	// A copied container gets its own pool.
+	Pool_allocator select_on_container_copy_construction() const
+	{
+		return Pool_allocator{};
+	}
+
+	Slab_pool& resource() const { return *pool; }
+
+	template<typename U>
+	bool operator==(const Pool_allocator<U>& other) const noexcept
+	{
+		return pool == other.pool;
+	}
+
+private:
+	template<typename U> friend class Pool_allocator;
+	std::shared_ptr<Slab_pool> pool;
+};
+
+#endif
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+	Fused Pipelines over Contiguous Data
+	-------------------------------------
+	print3(const std::ranges::range auto&) of Cpp20Concepts.cc
+	takes any range; std::views can build one lazily:
+
+	    auto r = v | std::views::filter(p) | std::views::transform(f);
+	    for (auto x : r) s += x;
+
+	Each view wraps the iterator of the one below it, and the
+	loop at the end goes through all of them per element:
+	filter's iterator is not random access, so nothing in
+	the loop tells the compiler it is a plain array, and the
+	loop stays scalar.
+
+	Here a pipeline is the array plus a tuple of stages:
+
+	    double s = from(v) | filter(p) | transform(f) | reduce(0.0, std::plus<>{});
+
+	The terminal reduce() runs one loop over the array, with
+	the stages applied to each element in turn (a filter
+	returns early, a transform replaces the value), so the
+	whole pipeline fuses into the body of that loop.
+
+	When every stage can also be applied to a vector of
+	elements (a generic lambda such as [](auto x) { return
+	x * x; } can, one taking double can't), the element type
+	stays the same, and the operation is std::plus,
+	std::multiplies, Min or Max, the loop runs on vectors as
+	in Accumulate.cc: filters produce lane masks, and lanes
+	that are filtered out contribute the operation's
+	identity (0, 1, +inf, -inf) instead of branching. Every
+	stage then sees every lane, including those an earlier
+	filter rejects, so stages must be safe on any value
+	(no integer division by what a filter excludes). A
+	generic lambda whose body only compiles for scalars
+	should take its argument as the scalar type, or it
+	breaks the check for vectors at compile time.
+
+	reduce(init, op, pool) cuts the array into blocks of
+	reduce_block elements, reduces them on the pool and
+	combines the results in a fixed pairwise tree, so the
+	result depends on the input only, not on the number of
+	threads (as accumulate() with a pool in Accumulate.cc).
+	Like there, the grouping of floating-point plus can
+	change the last bits compared with a left-to-right loop.
+*/
+
+// As in Accumulate.cc
+struct Min {
+	template<typename T>
+	T operator()(const T& a, const T& b) const { return b < a ? b : a; }
+};
+
+struct Max {
+	template<typename T>
+	T operator()(const T& a, const T& b) const { return a < b ? b : a; }
+};
+
+template<typename T>
+concept simd_element = std::is_arithmetic_v<T> && !std::same_as<T, bool> && sizeof(T) <= 8;
+
+template<typename Oper, typename T>
+concept simd_op = std::same_as<Oper, std::plus<T>> || std::same_as<Oper, std::plus<>>
+	|| std::same_as<Oper, std::multiplies<T>> || std::same_as<Oper, std::multiplies<>>
+	|| std::same_as<Oper, Min> || std::same_as<Oper, Max>;
+
+template<typename T, typename Oper>
+auto lane_op(Oper op)
+{
+	if constexpr (std::same_as<Oper, std::plus<T>>)
+		return std::plus<>{};
+	else if constexpr (std::same_as<Oper, std::multiplies<T>>)
+		return std::multiplies<>{};
+	else
+		return op;
+}
+
+// The value a filtered-out lane contributes
+template<typename T, typename Oper>
+T identity(Oper)
+{
+	if constexpr (std::same_as<Oper, Min>)
+		return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	else if constexpr (std::same_as<Oper, Max>)
+		return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+	else if constexpr (std::same_as<Oper, std::multiplies<T>> || std::same_as<Oper, std::multiplies<>>)
+		return T(1);
+	else
+		return T(0);
+}
+
+#if defined(__AVX__)
+constexpr std::size_t simd_bytes = 32;
+#else
+constexpr std::size_t simd_bytes = 16;
+#endif
+
+constexpr std::size_t reduce_block = 1 << 14;
+
+template<typename F>
+struct Filter { F pred; };
+
+template<typename F>
+struct Transform { F f; };
+
+template<typename Val, typename Oper>
+struct Reduce {
+	Val init;
+	Oper op;
+	Thread_pool* pool = nullptr;
+};
+
+template<typename F>
+Filter<F> filter(F pred) { return {std::move(pred)}; }
+
+template<typename F>
+Transform<F> transform(F f) { return {std::move(f)}; }
+
+template<typename Val, typename Oper>
+Reduce<Val, Oper> reduce(Val init, Oper op) { return {std::move(init), std::move(op)}; }
+
+template<typename Val, typename Oper>
+Reduce<Val, Oper> reduce(Val init, Oper op, Thread_pool& pool) { return {std::move(init), std::move(op), &pool}; }
+
+// Can the stage run on a vector V, keeping its type?
+template<typename V, typename Stage>
+constexpr bool lane_stage = false;
+
+template<typename V, typename F>
+constexpr bool lane_stage<V, Filter<F>> = requires(const F& f, V x) {
+	{ f(x) } -> std::same_as<decltype(x < x)>;
+};
+
+template<typename V, typename F>
+constexpr bool lane_stage<V, Transform<F>> = requires(const F& f, V x) {
+	{ f(x) } -> std::same_as<V>;
+};
+
+template<typename T, typename... Stages>
+class Pipeline {
+public:
+	Pipeline(std::span<const T> d, std::tuple<Stages...> s) : data{d}, stages{std::move(s)} {}
+
+	template<typename F>
+	Pipeline<T, Stages..., Filter<F>> operator|(Filter<F> s) const
+	{
+		return {data, std::tuple_cat(stages, std::tuple{std::move(s)})};
+	}
+
+	template<typename F>
+	Pipeline<T, Stages..., Transform<F>> operator|(Transform<F> s) const
+	{
+		return {data, std::tuple_cat(stages, std::tuple{std::move(s)})};
+	}
+
+	template<typename Val, typename Oper>
+	Val operator|(Reduce<Val, Oper> r) const
+	{
+		const std::size_t n = data.size();
+		if (!r.pool) return fold(0, n, std::move(r.init), r.op);
+		// Fixed blocks, combined in a fixed tree, as in Accumulate.cc
+		const std::size_t blocks = (n + reduce_block - 1) / reduce_block;
+		if (blocks == 0) return r.init;
+		std::vector<std::optional<Val>> part(blocks);
+		parallel_for(*r.pool, blocks, 4, [&](std::size_t b, std::size_t e) {
+			Oper f = r.op;
+			for (; b < e; ++b)
+				part[b] = fold_block<Val>(b * reduce_block, std::min(n, (b + 1) * reduce_block), f);
+		});
+		for (std::size_t w = 1; w < blocks; w *= 2)
+			for (std::size_t i = 0; i + w < blocks; i += 2 * w)
+				if (part[i + w]) part[i] = part[i] ? r.op(*part[i], *part[i + w]) : part[i + w];
+		return part[0] ? r.op(std::move(r.init), *part[0]) : r.init;
+	}
+
+private:
+	// Runs the stages on x; k(y) if it passes the filters
+	template<std::size_t I, typename X, typename K>
+	void apply(const X& x, K& k) const
+	{
+		if constexpr (I == sizeof...(Stages))
+			k(x);
+		else
+			apply_stage<I>(std::get<I>(stages), x, k);
+	}
+
+	template<std::size_t I, typename F, typename X, typename K>
+	void apply_stage(const Filter<F>& s, const X& x, K& k) const
+	{
+		if (s.pred(x)) apply<I + 1>(x, k);
+	}
+
+	template<std::size_t I, typename F, typename X, typename K>
+	void apply_stage(const Transform<F>& s, const X& x, K& k) const
+	{
+		apply<I + 1>(s.f(x), k);
+	}
+
+	// The same on a vector; filters clear lanes of keep
+	template<std::size_t I, typename V, typename M>
+	V apply_lanes(V x, M& keep) const
+	{
+		if constexpr (I == sizeof...(Stages))
+			return x;
+		else
+			return apply_lanes_stage<I>(std::get<I>(stages), x, keep);
+	}
+
+	template<std::size_t I, typename F, typename V, typename M>
+	V apply_lanes_stage(const Filter<F>& s, V x, M& keep) const
+	{
+		keep &= s.pred(x);
+		return apply_lanes<I + 1>(x, keep);
+	}
+
+	template<std::size_t I, typename F, typename V, typename M>
+	V apply_lanes_stage(const Transform<F>& s, V x, M& keep) const
+	{
+		return apply_lanes<I + 1>(s.f(x), keep);
+	}
+
+	// Whether the vector loop applies to a reduction with Oper into Val
+	template<typename Val, typename Oper>
+	static constexpr bool vectorizable()
+	{
+#if defined(__GNUC__)
+		if constexpr (simd_element<T> && std::same_as<Val, T> && simd_op<Oper, T>) {
+			typedef T V __attribute__((vector_size(simd_bytes)));
+			return (lane_stage<V, Stages> && ...);
+		}
+#endif
+		return false;
+	}
+
+	// s, combined with what passes the stages in [b, e)
+	template<typename Val, typename Oper>
+	Val fold(std::size_t b, std::size_t e, Val s, Oper& f) const
+	{
+		std::size_t i = b;
+#if defined(__GNUC__)
+		if constexpr (vectorizable<Val, Oper>()) {
+			typedef T V __attribute__((vector_size(simd_bytes)));
+			using M = decltype(V{} < V{});
+			constexpr std::size_t lanes = simd_bytes / sizeof(T);
+			constexpr std::size_t accs = 128 / simd_bytes;
+			constexpr std::size_t step = lanes * accs;
+			auto g = lane_op<T>(f);
+			V id;
+			for (std::size_t l = 0; l < lanes; ++l)
+				id[l] = identity<T>(f);
+			if (e - b >= step) {
+				V a[accs];
+				std::fill(a, a + accs, id);
+				for (; i + step <= e; i += step) {
+					for (std::size_t k = 0; k < accs; ++k) {
+						V x;
+						std::memcpy(&x, data.data() + i + k * lanes, sizeof x);
+						M keep = ~M{};
+						x = apply_lanes<0>(x, keep);
+						a[k] = g(a[k], keep ? x : id);
+					}
+				}
+				for (std::size_t w = accs / 2; w > 0; w /= 2)
+					for (std::size_t k = 0; k < w; ++k)
+						a[k] = g(a[k], a[k + w]);
+				T r = a[0][0];
+				for (std::size_t l = 1; l < lanes; ++l)
+					r = g(r, T(a[0][l]));
+				s = g(s, r);
+			}
+		}
+#endif
+		auto k = [&](const auto& y) { s = f(std::move(s), y); };
+		for (; i < e; ++i)
+			apply<0>(data[i], k);
+		return s;
+	}
+
+	// The reduction of what passes in [b, e), if anything does
+	template<typename Val, typename Oper>
+	std::optional<Val> fold_block(std::size_t b, std::size_t e, Oper& f) const
+	{
+		if constexpr (vectorizable<Val, Oper>()) {
+			// The identity changes nothing
+			return fold(b, e, identity<T>(f), f);
+		} else {
+			std::optional<Val> first;
+			auto k = [&](const auto& y) { first.emplace(y); };
+			for (; b < e && !first; ++b)
+				apply<0>(data[b], k);
+			if (!first) return first;
+			return fold(b, e, std::move(*first), f);
+		}
+	}
+
+	std::span<const T> data;
+	std::tuple<Stages...> stages;
+};
+
+template<typename T>
+Pipeline<T> from(std::span<const T> v) { return {v, {}}; }
+
+template<typename T>
+Pipeline<T> from(const std::vector<T>& v) { return {std::span<const T>{v}, {}}; }
+
+// A pipeline only views its source; it must not outlive a temporary vector
+template<typename T>
+void from(std::vector<T>&&) = delete;
+template<typename T>
+void from(const std::vector<T>&&) = delete;
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<int> small{1, -2, 3, -4, 5};
+	auto positive = [](auto x) { return x > 0; };
+	auto square = [](auto x) { return x * x; };
+	std::printf("%d %d %g\n", from(small) | filter(positive) | transform(square) | reduce(0, std::plus<>{}),
+		from(small) | transform(square) | reduce(0, Max{}),
+		from(small) | transform([](int x) { return std::sqrt(double(x * x)); }) | reduce(0.0, std::plus<>{}));
+
+	const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+	std::mt19937_64 rng{47};
+	std::uniform_real_distribution<double> u{-1, 1};
+	std::vector<double> v(n);
+	std::vector<int> iv(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		v[i] = u(rng);
+		iv[i] = int(rng() % 2001) - 1000;
+	}
+	Thread_pool pool;
+	const int passes = 10;
+
+	std::printf("%zu elements, %d passes; filter(x > 0) | transform(x * x) | reduce(plus)\n", n, passes);
+	double r1 = 0, r2 = 0, r3 = 0, r4 = 0;
+	double t1 = time_ms([&] {
+		for (int p = 0; p < passes; ++p) {
+			auto view = v | std::views::filter(positive) | std::views::transform(square);
+			double s = 0;
+			for (double x : view) s += x;
+			r1 = s;
+		}
+	});
+	double t2 = time_ms([&] {
+		for (int p = 0; p < passes; ++p) {
+			double s = 0;
+			for (double x : v)
+				if (x > 0) s += x * x;
+			r2 = s;
+		}
+	});
+	double t3 = time_ms([&] {
+		for (int p = 0; p < passes; ++p)
+			r3 = from(v) | filter(positive) | transform(square) | reduce(0.0, std::plus<>{});
+	});
+	double t4 = time_ms([&] {
+		for (int p = 0; p < passes; ++p)
+			r4 = from(v) | filter(positive) | transform(square) | reduce(0.0, std::plus<>{}, pool);
+	});
+	std::printf("std::views        %8.1f ms  %.17g\n", t1, r1);
+	std::printf("hand-written loop %8.1f ms  %.17g\n", t2, r2);
+	std::printf("fused, vectors    %8.1f ms  %.17g  %5.2fx\n", t3, r3, t1 / t3);
+	std::printf("fused, %u threads %7.1f ms  %.17g  %5.2fx\n", pool.size(), t4, r4, t1 / t4);
+
+	// A scalar-only stage: still one fused loop, without vectors
+	auto root = [](double x) { return std::sqrt(x); };
+	double r5 = 0, r6 = 0;
+	double t5 = time_ms([&] {
+		for (int p = 0; p < passes; ++p) {
+			auto view = v | std::views::filter(positive) | std::views::transform(root);
+			r5 = 0;
+			for (double x : view) r5 = std::max(r5, x);
+		}
+	});
+	double t6 = time_ms([&] {
+		for (int p = 0; p < passes; ++p)
+			r6 = from(v) | filter(positive) | transform(root) | reduce(0.0, Max{});
+	});
+	std::printf("sqrt, max: std::views %8.1f ms, fused scalar %8.1f ms  (%g %g)\n", t5, t6, r5, r6);
+
+	int r7 = 0, r8 = 0;
+	auto even = [](auto x) { return (x & 1) == 0; };
+	double t7 = time_ms([&] {
+		for (int p = 0; p < passes; ++p) {
+			auto view = iv | std::views::filter(even) | std::views::transform(square);
+			r7 = 0;
+			for (int x : view) r7 = std::max(r7, x);
+		}
+	});
+	double t8 = time_ms([&] {
+		for (int p = 0; p < passes; ++p)
+			r8 = from(iv) | filter(even) | transform(square) | reduce(0, Max{});
+	});
+	std::printf("int, largest even square: std::views %8.1f ms, fused vectors %8.1f ms  %5.2fx  (%d %d)\n",
+		t7, t8, t7 / t8, r7, r8);
+}
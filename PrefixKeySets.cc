@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	Key Normalization: Prefix Caching
+	-------------------------------------
+	The Person comparators of TransparentLambdaComparators.cc
+	compare full std::string names at every step down the
+	tree: load the node, follow the string's pointer to its
+	characters, then memcmp.
+
+	If we store the first 8 bytes of the key, big-endian,
+	as an integer beside each element, most comparisons are
+	decided by one integer compare on data already in the
+	node. Only when two prefixes tie do we look at the rest
+	of the strings.
+
+	Big-endian matters: comparing the integers must order
+	them the same way memcmp orders the bytes. Short keys
+	are padded with zeros, which is why a tie falls back to
+	the full comparison instead of declaring equality.
+
+	The layer is optional and works for any Type whose
+	ordering is the byte order of some string key; the key
+	projection is passed like a comparator.
+*/
+
+struct Person {
+	std::string name;
+};
+
+inline std::uint64_t key_prefix(std::string_view s)
+{
+	unsigned char b[8] = {};
+	std::memcpy(b, s.data(), std::min<std::size_t>(s.size(), 8));
+	std::uint64_t v = 0;
+	for (unsigned char c : b)
+		v = v << 8 | c;
+	return v;
+}
+
+// What the set stores: the cached prefix next to the element
+template<typename Type>
+struct Prefixed {
+	std::uint64_t prefix;
+	Type value;
+};
+
+// What lookups pass: the probe's prefix is computed once
+struct Prefix_probe {
+	std::uint64_t prefix;
+	std::string_view key;
+};
+
+template<typename Type, typename Key>
+struct Prefix_compare {
+	Key key;
+	using is_transparent = int;
+
+	static bool less(std::uint64_t pa, std::string_view a,
+		std::uint64_t pb, std::string_view b)
+	{
+		if (pa != pb) return pa < pb;
+		// Equal prefixes of two long keys: the first 8 bytes match
+		if (a.size() >= 8 && b.size() >= 8)
+			return a.substr(8) < b.substr(8);
+		return a < b;
+	}
+
+	bool operator()(const Prefixed<Type>& a, const Prefixed<Type>& b) const
+	{
+		return less(a.prefix, key(a.value), b.prefix, key(b.value));
+	}
+	bool operator()(const Prefix_probe& a, const Prefixed<Type>& b) const
+	{
+		return less(a.prefix, a.key, b.prefix, key(b.value));
+	}
+	bool operator()(const Prefixed<Type>& a, const Prefix_probe& b) const
+	{
+		return less(a.prefix, key(a.value), b.prefix, b.key);
+	}
+};
+
+template<typename Type, typename Key,
+	typename Allocator = std::allocator<Prefixed<Type>>>
+class Prefix_set {
+public:
+	using set_type = std::set<Prefixed<Type>, Prefix_compare<Type, Key>, Allocator>;
+	using iterator = typename set_type::const_iterator;
+
+	explicit Prefix_set(Key k) : s{Prefix_compare<Type, Key>{std::move(k)}} {}
+
+	std::pair<iterator, bool> insert(Type v)
+	{
+		std::uint64_t p = key_prefix(s.key_comp().key(v));
+		return s.insert(Prefixed<Type>{p, std::move(v)});
+	}
+
+	iterator find(std::string_view k) const { return s.find(probe(k)); }
+	std::size_t count(std::string_view k) const { return s.count(probe(k)); }
+	bool contains(std::string_view k) const { return s.contains(probe(k)); }
+	iterator lower_bound(std::string_view k) const { return s.lower_bound(probe(k)); }
+	iterator upper_bound(std::string_view k) const { return s.upper_bound(probe(k)); }
+
+	iterator begin() const { return s.begin(); }
+	iterator end() const { return s.end(); }
+	std::size_t size() const { return s.size(); }
+
+private:
+	static Prefix_probe probe(std::string_view k) { return {key_prefix(k), k}; }
+	set_type s;
+};
+
+// Like make_set, but the ordering comes from a string key
+template<typename Type, typename Key>
+auto make_prefix_set(Key&& key)
+{
+	return Prefix_set<Type, std::decay_t<Key>>{std::forward<Key>(key)};
+}
+
+template<typename ...Comparator>
+struct Overloaded_compare : Comparator... {
+	using Comparator::operator()...;
+	using is_transparent = int;
+};
+
+template<typename Type, typename ...Comparator>
+auto make_set(Comparator&& ... comparator)
+{
+	using Compare = Overloaded_compare<std::decay_t<Comparator>...>;
+	return std::set<Type, Compare>{Compare{std::forward<Comparator>(comparator)...}};
+}
+
+/*
+	Realistic names: surnames drawn with a skewed
+	distribution, so popular surnames dominate as in
+	real customer data. Surname-first keys share long
+	prefixes and tie more often than given-name-first.
+*/
+std::vector<std::string> make_names(int n, bool surname_first)
+{
+	const char* surnames[] = {
+		"Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller",
+		"Davis", "Rodriguez", "Martinez", "Hernandez", "Lopez", "Gonzalez",
+		"Wilson", "Anderson", "Thomas", "Taylor", "Moore", "Jackson", "Martin",
+		"Lee", "Perez", "Thompson", "White", "Harris", "Sanchez", "Clark",
+		"Ramirez", "Lewis", "Robinson", "Walker", "Young", "Allen", "King",
+		"Wright", "Scott", "Torres", "Nguyen", "Hill", "Flores", "Green",
+		"Adams", "Nelson", "Baker", "Hall", "Rivera", "Campbell", "Mitchell",
+		"Carter", "Roberts", "Kowalski", "Nakamura", "Okafor", "Schmidt"};
+	const char* given[] = {
+		"James", "Mary", "Robert", "Patricia", "John", "Jennifer", "Michael",
+		"Linda", "David", "Elizabeth", "William", "Barbara", "Richard", "Susan",
+		"Joseph", "Jessica", "Thomas", "Sarah", "Charles", "Karen", "Wanjiru",
+		"Hiroshi", "Chiamaka", "Mateo", "Sofia", "Liam", "Olivia", "Noah"};
+	std::mt19937 rng{2024};
+	std::geometric_distribution<int> pick_surname{0.08};
+	std::uniform_int_distribution<int> pick_given{0, int(std::size(given)) - 1};
+	std::vector<std::string> names;
+	names.reserve(n);
+	for (int i = 0; i < n; ++i) {
+		int s = std::min<int>(pick_surname(rng), int(std::size(surnames)) - 1);
+		std::string first = surnames[s];
+		std::string second = given[pick_given(rng)];
+		if (!surname_first) std::swap(first, second);
+		names.push_back(first + " " + second + " " + std::to_string(i));
+	}
+	return names;
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void bench(const char* label, const std::vector<std::string>& names)
+{
+	std::vector<std::string> probes = names;
+	std::shuffle(probes.begin(), probes.end(), std::mt19937{7});
+	auto plain = make_set<Person>(
+		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
+		[](std::string_view lhs, const Person& rhs){ return lhs < rhs.name; },
+		[](const Person &lhs, std::string_view rhs){ return lhs.name < rhs; }
+	);
+	auto prefixed = make_prefix_set<Person>(
+		[](const Person& p) -> std::string_view { return p.name; });
+	for (auto& s : names) {
+		plain.insert(Person{s});
+		prefixed.insert(Person{s});
+	}
+
+	std::size_t h1 = 0, h2 = 0;
+	double t_plain = time_ms([&] {
+		for (auto& s : probes) h1 += plain.contains(std::string_view{s});
+	});
+	double t_prefixed = time_ms([&] {
+		for (auto& s : probes) h2 += prefixed.contains(s);
+	});
+	std::printf("%-14s %zu lookups: full-string %.1f ms (%.2f M/s), prefix %.1f ms (%.2f M/s)%s\n",
+		label, probes.size(), t_plain, probes.size() / t_plain / 1e3,
+		t_prefixed, probes.size() / t_prefixed / 1e3,
+		h1 == h2 ? "" : "  MISMATCH");
+}
+
+int main(int argc, char* argv[])
+{
+	auto people = make_prefix_set<Person>(
+		[](const Person& p) -> std::string_view { return p.name; });
+	for (const char* s : {"Ada Lovelace", "Alan Turing", "Alan Kay", "Barbara Liskov"})
+		people.insert(Person{s});
+	for (auto& p : people)
+		std::printf("%016llx %s\n", (unsigned long long)p.prefix, p.value.name.c_str());
+	std::printf("%zu %s\n", people.count("Alan Turing"), people.lower_bound("Alan L")->value.name.c_str());
+
+	const int n = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+	bench("surname first", make_names(n, true));
+	bench("given first", make_names(n, false));
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+	A Sharded Concurrent Ordered Set
+	-------------------------------------
+	Wrapping the std::set from make_set in one mutex makes
+	every thread wait for every other thread, readers
+	included.
+
+	Sharding by key range keeps the set ordered:
+	a sorted list of splitter keys divides the key space,
+	shard i holds the keys in [splitter[i-1], splitter[i]).
+	Threads working on different ranges never touch the same
+	lock, and walking the shards in order still visits keys
+	in comparator order.
+
+	Each shard is read-optimized: a shared_mutex lets any
+	number of readers in at once; writers take it exclusively.
+	Shards are cache-line aligned so their locks don't share
+	a line (false sharing).
+
+	The comparator is injected the same way as in make_set,
+	including the transparent overloads, so lookups by
+	std::string_view still build no temporaries.
+*/
+
+struct Person {
+	std::string name;
+};
+
+template<typename ...Comparator>
+struct Overloaded_compare : Comparator... {
+	using Comparator::operator()...;
+	using is_transparent = int;
+};
+
+template<typename Type, typename Compare, typename Allocator = std::allocator<Type>>
+class Sharded_set {
+	struct alignas(64) Shard {
+		mutable std::shared_mutex m;
+		std::set<Type, Compare, Allocator> s;
+		explicit Shard(const Compare& c) : s{c} {}
+	};
+
+public:
+	// splitters must be sorted under c; n splitters give n+1 shards
+	Sharded_set(std::vector<Type> splitters, Compare c)
+		: cmp{std::move(c)}, split{std::move(splitters)}
+	{
+		shards.reserve(split.size() + 1);
+		for (std::size_t i = 0; i <= split.size(); ++i)
+			shards.push_back(std::make_unique<Shard>(cmp));
+	}
+
+	bool insert(Type v)
+	{
+		Shard& sh = shard_for(v);
+		std::unique_lock lock{sh.m};
+		return sh.s.insert(std::move(v)).second;
+	}
+
+	template<typename K>
+	bool erase(const K& k)
+	{
+		Shard& sh = shard_for(k);
+		std::unique_lock lock{sh.m};
+		auto it = sh.s.find(k);
+		if (it == sh.s.end()) return false;
+		sh.s.erase(it);
+		return true;
+	}
+
+	template<typename K>
+	bool contains(const K& k) const
+	{
+		const Shard& sh = shard_for(k);
+		std::shared_lock lock{sh.m};
+		return sh.s.find(k) != sh.s.end();
+	}
+
+	// A copy: an iterator would outlive the lock.
+	template<typename K>
+	std::optional<Type> find(const K& k) const
+	{
+		const Shard& sh = shard_for(k);
+		std::shared_lock lock{sh.m};
+		auto it = sh.s.find(k);
+		if (it == sh.s.end()) return std::nullopt;
+		return *it;
+	}
+
+	/*
+		Ordered visit of [lo, hi). Each shard is locked
+		(shared) only while it is being read, so the scan
+		is consistent per shard, not a global snapshot.
+	*/
+	template<typename K, typename F>
+	void scan(const K& lo, const K& hi, F f) const
+	{
+		for (std::size_t i = shard_index(lo); i < shards.size(); ++i) {
+			const Shard& sh = *shards[i];
+			std::shared_lock lock{sh.m};
+			for (auto it = sh.s.lower_bound(lo); it != sh.s.end(); ++it) {
+				if (!cmp(*it, hi)) return;
+				f(*it);
+			}
+		}
+	}
+
+	template<typename F>
+	void for_each(F f) const
+	{
+		for (auto& sh : shards) {
+			std::shared_lock lock{sh->m};
+			for (auto& v : sh->s) f(v);
+		}
+	}
+
+	std::size_t size() const
+	{
+		std::size_t n = 0;
+		for (auto& sh : shards) {
+			std::shared_lock lock{sh->m};
+			n += sh->s.size();
+		}
+		return n;
+	}
+
+	std::size_t shard_count() const { return shards.size(); }
+
+private:
+	template<typename K>
+	std::size_t shard_index(const K& k) const
+	{
+		return std::upper_bound(split.begin(), split.end(), k,
+			[this](const K& x, const Type& s) { return cmp(x, s); }) - split.begin();
+	}
+
+	template<typename K>
+	Shard& shard_for(const K& k) const { return *shards[shard_index(k)]; }
+
+	Compare cmp;
+	std::vector<Type> split;
+	std::vector<std::unique_ptr<Shard>> shards;
+};
+
+// Evenly spaced splitters from a sample of the expected keys
+template<typename Type, typename Compare>
+std::vector<Type> choose_splitters(std::vector<Type> sample, std::size_t shards, const Compare& cmp)
+{
+	std::sort(sample.begin(), sample.end(), cmp);
+	std::vector<Type> split;
+	for (std::size_t i = 1; i < shards && !sample.empty(); ++i) {
+		const Type& s = sample[i * sample.size() / shards];
+		if (split.empty() || cmp(split.back(), s)) split.push_back(s);
+	}
+	return split;
+}
+
+template<typename Type, typename Allocator = std::allocator<Type>,
+	typename ...Comparator>
+auto make_sharded_set(const std::vector<Type>& sample, std::size_t shards,
+	Comparator&& ... comparator)
+{
+	using Compare = Overloaded_compare<std::decay_t<Comparator>...>;
+	Compare cmp{std::forward<Comparator>(comparator)...};
+	auto split = choose_splitters(sample, shards, cmp);
+	return Sharded_set<Type, Compare, Allocator>{std::move(split), std::move(cmp)};
+}
+
+// The baseline: one std::set, one mutex
+template<typename Type, typename Compare>
+class Locked_set {
+public:
+	explicit Locked_set(Compare c) : s{std::move(c)} {}
+	bool insert(Type v) { std::lock_guard lock{m}; return s.insert(std::move(v)).second; }
+	template<typename K>
+	bool erase(const K& k)
+	{
+		std::lock_guard lock{m};
+		auto it = s.find(k);
+		if (it == s.end()) return false;
+		s.erase(it);
+		return true;
+	}
+	template<typename K>
+	bool contains(const K& k) const { std::lock_guard lock{m}; return s.find(k) != s.end(); }
+private:
+	mutable std::mutex m;
+	std::set<Type, Compare> s;
+};
+
+/*
+	Mixed workload: 80% lookups, 15% inserts, 5% erases over
+	a pre-filled key space, run with 1, 2, 4, .. threads.
+*/
+template<typename Set>
+double run(Set& set, const std::vector<std::string>& keys, int threads, int ops_per_thread)
+{
+	std::atomic<bool> go{false};
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([&, t] {
+			std::mt19937 rng(t + 1);
+			std::uniform_int_distribution<std::size_t> pick{0, keys.size() - 1};
+			std::uniform_int_distribution<int> op{0, 99};
+			while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+			for (int i = 0; i < ops_per_thread; ++i) {
+				const std::string& k = keys[pick(rng)];
+				int o = op(rng);
+				if (o < 80) set.contains(std::string_view{k});
+				else if (o < 95) set.insert(Person{k});
+				else set.erase(std::string_view{k});
+			}
+		});
+	}
+	auto t0 = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	for (auto& th : pool) th.join();
+	auto t1 = std::chrono::steady_clock::now();
+	double s = std::chrono::duration<double>(t1 - t0).count();
+	return threads * double(ops_per_thread) / s / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+	auto by_name = [](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; };
+	auto sv_lhs = [](std::string_view lhs, const Person& rhs){ return lhs < rhs.name; };
+	auto sv_rhs = [](const Person &lhs, std::string_view rhs){ return lhs.name < rhs; };
+
+	const int max_threads = argc > 1 ? std::atoi(argv[1])
+		: std::max(16u, std::thread::hardware_concurrency());
+	const int n = argc > 2 ? std::atoi(argv[2]) : 200'000;
+	const int ops = argc > 3 ? std::atoi(argv[3]) : 200'000;
+
+	std::vector<std::string> keys;
+	std::vector<Person> sample;
+	std::mt19937 rng{3};
+	for (int i = 0; i < n; ++i) {
+		keys.push_back("person-" + std::to_string(rng()));
+		if (i % 64 == 0) sample.push_back(Person{keys.back()});
+	}
+
+	auto people = make_sharded_set<Person>(sample, 64, by_name, sv_lhs, sv_rhs);
+	people.insert(Person{"person-1"});
+	people.insert(Person{"person-2"});
+	people.scan(std::string_view{"person-1"}, std::string_view{"person-3"},
+		[](const Person& p) { std::printf("%s ", p.name.c_str()); });
+	std::printf("(%zu shards)\n", people.shard_count());
+
+	std::printf("threads  one-mutex Mops/s  sharded Mops/s\n");
+	for (int t = 1; t <= max_threads; t *= 2) {
+		Locked_set<Person, Overloaded_compare<decltype(by_name), decltype(sv_lhs), decltype(sv_rhs)>>
+			locked{{by_name, sv_lhs, sv_rhs}};
+		auto sharded = make_sharded_set<Person>(sample, 64, by_name, sv_lhs, sv_rhs);
+		for (int i = 0; i < n; i += 2) {
+			locked.insert(Person{keys[i]});
+			sharded.insert(Person{keys[i]});
+		}
+		double a = run(locked, keys, t, ops / t);
+		double b = run(sharded, keys, t, ops / t);
+		std::printf("%7d  %15.2f  %14.2f\n", t, a, b);
+	}
+	std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+}
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <random>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+	Streaming Statistics
+	-------------------------------------
+	Average() answers one question about one vector. A
+	metrics pipeline asks the same question every tick about
+	a stream that keeps growing; recomputing over the whole
+	history makes each tick O(n). The accumulators below
+	keep a constant-size summary and update it in O(1) per
+	sample:
+
+	- Running_stats: count, mean and variance by Welford's
+	  method, plus min and max. The mean is updated by the
+	  deviation of each sample, and the variance through the
+	  sum of squared deviations M2, so neither suffers the
+	  cancellation of the textbook sum(x^2) - n * mean^2.
+	  Two summaries merge exactly (Chan et al.), so shards or
+	  threads can summarize their part and combine:
+
+	      n  = na + nb,  d = mean_b - mean_a
+	      mean = mean_a + d * nb / n
+	      M2 = M2a + M2b + d^2 * na * nb / n
+
+	  A batch is summarized on its own in two passes, while
+	  it is in cache, and then merged the same way.
+
+	- Window_stats: the same over the last w samples only.
+	  A sample leaving the window is removed by running
+	  Welford's update backwards; removal is less stable than
+	  adding, so the summary is recomputed from the window
+	  every w samples (O(1) amortized). Min and max come from
+	  monotonic queues. Memory is O(w).
+
+	- Decayed_stats: exponentially weighted mean and
+	  variance, where a sample's weight halves every
+	  half_life samples; no history is kept at all.
+
+	All are constrained by the numeric concept; statistics
+	are computed in double, min and max are kept as T.
+*/
+
+// As in Cpp20Concepts.cc
+template<typename T>
+concept numeric = std::is_integral_v<T> || std::is_floating_point_v<T>;
+
+template<numeric T>
+class Running_stats {
+public:
+	void push(T x)
+	{
+		++n;
+		double d = double(x) - m;
+		m += d / double(n);
+		m2 += d * (double(x) - m);
+		lo = std::min(lo, x);
+		hi = std::max(hi, x);
+	}
+
+	void push(std::span<const T> batch)
+	{
+		if (batch.empty()) return;
+		Running_stats b;
+		double s = 0;
+		b.lo = b.hi = batch[0];
+		for (T x : batch) {
+			s += double(x);
+			b.lo = std::min(b.lo, x);
+			b.hi = std::max(b.hi, x);
+		}
+		b.n = batch.size();
+		b.m = s / double(b.n);
+		for (T x : batch)
+			b.m2 += (double(x) - b.m) * (double(x) - b.m);
+		merge(b);
+	}
+
+	void merge(const Running_stats& o)
+	{
+		if (o.n == 0) return;
+		if (n == 0) {
+			*this = o;
+			return;
+		}
+		const double na = double(n), nb = double(o.n), d = o.m - m;
+		n += o.n;
+		m += d * nb / double(n);
+		m2 += o.m2 + d * d * na * nb / double(n);
+		lo = std::min(lo, o.lo);
+		hi = std::max(hi, o.hi);
+	}
+
+	std::size_t count() const { return n; }
+	double mean() const { return n ? m : std::numeric_limits<double>::quiet_NaN(); }
+	double variance() const { return n ? m2 / double(n) : std::numeric_limits<double>::quiet_NaN(); }
+	double sample_variance() const { return n > 1 ? m2 / double(n - 1) : std::numeric_limits<double>::quiet_NaN(); }
+	double stddev() const { return std::sqrt(variance()); }
+	T min() const { return lo; }
+	T max() const { return hi; }
+
+private:
+	std::size_t n = 0;
+	double m = 0;
+	double m2 = 0;
+	T lo = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+	T hi = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+};
+
+template<numeric T>
+class Window_stats {
+public:
+	explicit Window_stats(std::size_t window) : ring(std::max<std::size_t>(1, window)) {}
+
+	void push(T x)
+	{
+		const std::size_t w = ring.size();
+		if (n == w) {
+			remove(ring[t % w]);
+			while (!lows.empty() && lows.front().first + w <= t) lows.pop_front();
+			while (!highs.empty() && highs.front().first + w <= t) highs.pop_front();
+		}
+		ring[t % w] = x;
+		add(x);
+		while (!lows.empty() && !(lows.back().second < x)) lows.pop_back();
+		lows.emplace_back(t, x);
+		while (!highs.empty() && !(x < highs.back().second)) highs.pop_back();
+		highs.emplace_back(t, x);
+		++t;
+		if (t % w == 0) rebuild();
+	}
+
+	std::size_t count() const { return n; }
+	double mean() const { return n ? m : std::numeric_limits<double>::quiet_NaN(); }
+	double variance() const { return n ? std::max(0.0, m2) / double(n) : std::numeric_limits<double>::quiet_NaN(); }
+	double stddev() const { return std::sqrt(variance()); }
+	// count() > 0
+	T min() const { return lows.front().second; }
+	T max() const { return highs.front().second; }
+
+private:
+	void add(T x)
+	{
+		++n;
+		double d = double(x) - m;
+		m += d / double(n);
+		m2 += d * (double(x) - m);
+	}
+
+	void remove(T x)
+	{
+		if (--n == 0) {
+			m = m2 = 0;
+			return;
+		}
+		double d = double(x) - m;
+		m -= d / double(n);
+		m2 -= d * (double(x) - m);
+	}
+
+	// Two passes over the window, to drop the drift of remove()
+	void rebuild()
+	{
+		double s = 0;
+		for (std::size_t i = 0; i < n; ++i) s += double(ring[i]);
+		m = s / double(n);
+		m2 = 0;
+		for (std::size_t i = 0; i < n; ++i) m2 += (double(ring[i]) - m) * (double(ring[i]) - m);
+	}
+
+	std::vector<T> ring;	// the window; slot t % w holds sample t
+	std::size_t n = 0;	// samples in the window
+	std::uint64_t t = 0;	// samples seen
+	double m = 0;
+	double m2 = 0;
+	std::deque<std::pair<std::uint64_t, T>> lows;	// increasing values: front is the min
+	std::deque<std::pair<std::uint64_t, T>> highs;	// decreasing values: front is the max
+};
+
+template<numeric T>
+class Decayed_stats {
+public:
+	// A sample's weight halves every half_life samples
+	explicit Decayed_stats(double half_life) : alpha{1 - std::exp2(-1 / half_life)} {}
+
+	void push(T x)
+	{
+		if (n++ == 0) {
+			m = double(x);
+			return;
+		}
+		double d = double(x) - m;
+		double inc = alpha * d;
+		m += inc;
+		v = (1 - alpha) * (v + d * inc);
+	}
+
+	std::size_t count() const { return n; }
+	double mean() const { return n ? m : std::numeric_limits<double>::quiet_NaN(); }
+	double variance() const { return n ? v : std::numeric_limits<double>::quiet_NaN(); }
+	double stddev() const { return std::sqrt(variance()); }
+
+private:
+	double alpha;
+	std::size_t n = 0;
+	double m = 0;
+	double v = 0;
+};
+
+// What a tick costs today: two passes over everything
+template<typename T>
+std::pair<double, double> mean_variance(std::span<const T> v)
+{
+	double s = 0;
+	for (T x : v) s += double(x);
+	double m = s / double(v.size()), m2 = 0;
+	for (T x : v) m2 += (double(x) - m) * (double(x) - m);
+	return {m, m2 / double(v.size())};
+}
+
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	Running_stats<int> rs;
+	Window_stats<int> ws{3};
+	Decayed_stats<int> ds{2};
+	for (int x : {4, 8, 15, 16, 23, 42}) {
+		rs.push(x);
+		ws.push(x);
+		ds.push(x);
+	}
+	std::printf("all: mean %g sd %g min %d max %d; last 3: mean %g min %d max %d; decayed mean %g\n",
+		rs.mean(), rs.stddev(), rs.min(), rs.max(), ws.mean(), ws.min(), ws.max(), ds.mean());
+
+	const int ticks = argc > 1 ? std::atoi(argv[1]) : 2000;
+	const std::size_t per_tick = 1000, window = 100'000;
+	std::mt19937_64 rng{6};
+	std::normal_distribution<double> dist{1e6, 25};
+
+	std::vector<double> history;
+	Running_stats<double> all;
+	Window_stats<double> recent{window};
+	double t_full = 0, t_stream = 0, t_wfull = 0, t_wstream = 0;
+	double check = 0;
+	for (int k = 0; k < ticks; ++k) {
+		std::vector<double> batch(per_tick);
+		for (auto& x : batch) x = dist(rng);
+		history.insert(history.end(), batch.begin(), batch.end());
+
+		t_full += time_ms([&] { check += mean_variance<double>(history).second; });
+		t_stream += time_ms([&] {
+			all.push(std::span<const double>{batch});
+			check += all.variance();
+		});
+		std::size_t w = std::min(window, history.size());
+		t_wfull += time_ms([&] {
+			check += mean_variance<double>(std::span<const double>{history}.last(w)).second;
+		});
+		t_wstream += time_ms([&] {
+			for (double x : batch) recent.push(x);
+			check += recent.variance();
+		});
+	}
+	auto [m, v] = mean_variance<double>(history);
+	const std::size_t w = std::min(window, history.size());
+	auto [wm, wv] = mean_variance<double>(std::span<const double>{history}.last(w));
+	std::printf("%d ticks of %zu samples (%zu in all, checksum %g)\n", ticks, per_tick, history.size(), check);
+	std::printf("everything:  recompute %8.1f ms  streaming %6.1f ms  (mean %.9g vs %.9g, var %.9g vs %.9g)\n",
+		t_full, t_stream, m, all.mean(), v, all.variance());
+	std::printf("last %zu: recompute %8.1f ms  streaming %6.1f ms  (mean %.9g vs %.9g, var %.9g vs %.9g)\n",
+		w, t_wfull, t_wstream, wm, recent.mean(), wv, recent.variance());
+
+	// Shards summarize separately and merge
+	const int shards = 4;
+	std::vector<Running_stats<double>> part(shards);
+	for (std::size_t i = 0; i < history.size(); ++i)
+		part[i % shards].push(history[i]);
+	Running_stats<double> merged;
+	for (auto& p : part) merged.merge(p);
+	std::printf("%d shards merged: mean %.9g var %.9g min %.9g max %.9g\n",
+		shards, merged.mean(), merged.variance(), merged.min(), merged.max());
+
+	Decayed_stats<double> decayed{1000};
+	double t_decay = time_ms([&] { for (double x : history) decayed.push(x); });
+	std::printf("decayed (half-life 1000): mean %.9g sd %.4g, %.2f ns/sample\n",
+		decayed.mean(), decayed.stddev(), t_decay * 1e6 / double(history.size()));
+}
@@ -1,20 +1,67 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
 #include <set>
 #include <string>
+#include <vector>
+
+#include "NodePool.h"
 
 struct Person {
 	std::string name;
 };
 
-template<typename Comparator>
+/*
+	The allocator is a policy, just like the comparator.
+	make_set<Person>(cmp) uses the default allocator,
+	make_set<Person, Pool_allocator<Person>>(cmp) puts the
+	nodes of this set into their own slab pool.
+*/
+template<typename Type, typename Allocator = std::allocator<Type>,
+	typename Comparator>
 auto  make_set(Comparator &&comparator)
 {
-	return std::set<Person, std::decay_t<Comparator>>{std::forward<Comparator>(comparator)};
+	return std::set<Type, std::decay_t<Comparator>, Allocator>{
+		std::forward<Comparator>(comparator), Allocator{}};
 }
 
+template<typename F>
+double time_ms(F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	f();
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+template<typename Set>
+void bench(const char* label, Set set, const std::vector<std::string>& names)
+{
+	// Interleaved allocations that outlive the inserts, as in
+	// a real program, scatter heap-allocated nodes.
+	std::vector<std::unique_ptr<char[]>> noise;
+	noise.reserve(names.size());
+	double t_insert = time_ms([&] {
+		for (auto& s : names) {
+			set.insert(Person{s});
+			noise.emplace_back(new char[48]);
+		}
+	});
+	std::size_t total = 0;
+	double t_walk = time_ms([&] {
+		for (int pass = 0; pass < 10; ++pass)
+			for (auto& p : set) total += p.name.size();
+	});
+	double t_destroy = time_ms([&] { Set gone = std::move(set); });
+	std::printf("%-8s insert %8.2f ms  10x traverse %8.2f ms  destroy %8.2f ms  (%zu)\n",
+		label, t_insert, t_walk, t_destroy, total);
+}
 
+int main(int argc, char* argv[])  {
 
-int main()  {
-		
 	/* auto comparator = [](const Person &lhs, const Person& rhs){
 		return lhs.name < rhs.name;
 	};
@@ -22,33 +69,22 @@ int main()  {
 
 	auto set = make_set<Person>([](const Person &lhs, const Person &rhs){
 		return lhs.name < rhs.name;
-	};
-}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+	});
 
+	auto pooled = make_set<Person, Pool_allocator<Person>>([](const Person &lhs, const Person &rhs){
+		return lhs.name < rhs.name;
+	});
+	pooled.insert(Person{"Ada"});
+	pooled.insert(Person{"Alan"});
+	std::printf("%zu people in %zu slab(s)\n", pooled.size(),
+		pooled.get_allocator().resource().slab_count());
+
+	const int n = argc > 1 ? std::atoi(argv[1]) : 500'000;
+	std::vector<std::string> names;
+	for (int i = 0; i < n; ++i) names.push_back("P" + std::to_string(i));
+	std::shuffle(names.begin(), names.end(), std::mt19937{1});
+
+	auto by_name = [](const Person &lhs, const Person &rhs){ return lhs.name < rhs.name; };
+	bench("default", make_set<Person>(by_name), names);
+	bench("pooled", make_set<Person, Pool_allocator<Person>>(by_name), names);
+}
@@ -507,6 +507,9 @@ void printf(const char* s, T value, Args... args)
 	}
 	throw std::runtime_error("extra arguments provided to printf");
 }
+
+// Checked at compile time and parsed once: FormatString.h
+// Formatted and written on another thread, the caller only copies: AsyncLog.cc
 /*
 	The Args... defines what is callled a parameter pack.
 	A parameter pack is a sequence of (type/value) pairs
@@ -103,6 +103,13 @@ void f(List<Glob>& lb, List<string>& ls)
 	// .. use operations on lb, but not lb.sort()
 }
 
+/*
+	Only List<string>::sort() is generated here; List<Glob>
+	need not even be comparable. ListSort.cc gives sort()
+	a real definition: a stable, allocation-free natural
+	merge sort that relinks nodes.
+*/
+
 /* 
 	Manual Control of Instantiation
 
@@ -398,6 +405,7 @@ public:
 	void sort(); // sort elements
 	// ..
 };
+// A parallel sort() for it: ContainerSort.cc
 
 // point of instantiation of Container<int>
 void f()
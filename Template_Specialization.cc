@@ -158,6 +158,15 @@ map<string,int,std::greater<string>> m2;
 auto cmp = [](const string& x, const string& y)
 			{ return x<y; }
 
+/*
+	Because the ordering is just an argument, the
+	representation behind the interface can change.
+	BtreeMap.cc keeps map<Key,V,Compare> (lambdas
+	included) but stores many keys per cache-line
+	sized node with linked leaves for fast ordered
+	scans and bulk loading.
+*/
+
 /*
 	Templates As Arguments
 	
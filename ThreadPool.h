@@ -0,0 +1,227 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+	A Work-Stealing Thread Pool
+	-------------------------------------
+	Each worker owns a deque of tasks. A worker pushes and
+	pops at the back of its own deque (newest first, which
+	keeps its data hot) and, when that runs dry, steals from
+	the front of another worker's deque (oldest first, which
+	tends to be the biggest piece of remaining work).
+
+	Thread_pool(n) gives n-way parallelism: n - 1 worker
+	threads plus the calling thread, which helps run tasks
+	while it waits in Task_group::wait(). So Thread_pool(1)
+	runs everything on the caller, and nested fork-join
+	(a task that spawns and waits for tasks) can't deadlock.
+
+	The deques are plain mutex-protected std::deques; the
+	tasks here are coarse (thousands of elements each), so
+	the lock is not where the time goes.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Thread_pool {
+public:
+	explicit Thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+		: queues(std::max(1u, threads))
+	{
+		for (unsigned i = 1; i < queues.size(); ++i)
+			workers.emplace_back([this, i] { work(i); });
+	}
+
+	Thread_pool(const Thread_pool&) = delete;
+	Thread_pool& operator=(const Thread_pool&) = delete;
+
+	~Thread_pool()
+	{
+		{
+			std::lock_guard lock{sleep_m};
+			done = true;
+		}
+		wake.notify_all();
+		for (auto& w : workers) w.join();
+	}
+
+	// The pool behind Container<T>::sort() and friends
+	static Thread_pool& shared()
+	{
+		static Thread_pool pool;
+		return pool;
+	}
+
+	unsigned size() const { return unsigned(queues.size()); }
+
+	void submit(std::function<void()> task)
+	{
+		unsigned q = self_pool == this ? self_index : next.fetch_add(1) % size();
+		{
+			std::lock_guard lock{queues[q].m};
+			queues[q].tasks.push_back(std::move(task));
+		}
+		{
+			// Under sleep_m, so a worker can't miss the wake-up
+			std::lock_guard lock{sleep_m};
+			pending.fetch_add(1, std::memory_order_release);
+		}
+		wake.notify_one();
+	}
+
+	// Runs one queued task, own deque first; false if none found
+	bool run_one()
+	{
+		unsigned me = self_pool == this ? self_index : 0;
+		std::function<void()> task;
+		if (!pop_back(me, task)) {
+			for (unsigned k = 1; k < size() && !task; ++k)
+				steal(me + k < size() ? me + k : me + k - size(), task);
+			if (!task) return false;
+		}
+		pending.fetch_sub(1, std::memory_order_relaxed);
+		task();
+		return true;
+	}
+
+private:
+	struct Queue {
+		std::mutex m;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	bool pop_back(unsigned q, std::function<void()>& task)
+	{
+		std::lock_guard lock{queues[q].m};
+		if (queues[q].tasks.empty()) return false;
+		task = std::move(queues[q].tasks.back());
+		queues[q].tasks.pop_back();
+		return true;
+	}
+
+	bool steal(unsigned q, std::function<void()>& task)
+	{
+		std::unique_lock lock{queues[q].m, std::try_to_lock};
+		if (!lock || queues[q].tasks.empty()) return false;
+		task = std::move(queues[q].tasks.front());
+		queues[q].tasks.pop_front();
+		return true;
+	}
+
+	void work(unsigned i)
+	{
+		self_pool = this;
+		self_index = i;
+		for (;;) {
+			if (run_one()) continue;
+			std::unique_lock lock{sleep_m};
+			wake.wait(lock, [this] { return done || pending.load(std::memory_order_acquire) > 0; });
+			if (done) return;
+		}
+	}
+
+	std::vector<Queue> queues;
+	std::vector<std::thread> workers;
+	std::atomic<unsigned> next{0};
+	std::atomic<long> pending{0};
+	std::mutex sleep_m;
+	std::condition_variable wake;
+	bool done = false;
+
+	static inline thread_local Thread_pool* self_pool = nullptr;
+	static inline thread_local unsigned self_index = 0;
+};
+
+/*
+	Fork-join: run() tasks, then wait() for all of them.
+
+	A task that throws doesn't take down the thread that
+	ran it: the first exception is kept, the group's tasks
+	that haven't started yet are skipped, and wait()
+	rethrows it once every task has finished. The
+	destructor also waits but, being a destructor (possibly
+	running during unwinding), doesn't rethrow; call wait()
+	to see a task's exception.
+*/
+class Task_group {
+public:
+	explicit Task_group(Thread_pool& p) : pool{p} {}
+	~Task_group() { join(); }
+
+	template<typename F>
+	void run(F f)
+	{
+		left.fetch_add(1, std::memory_order_relaxed);
+		pool.submit([this, f = std::move(f)]() mutable {
+			if (!failed.load(std::memory_order_relaxed)) {
+				try {
+					f();
+				} catch (...) {
+					std::lock_guard lock{error_m};
+					if (!error) error = std::current_exception();
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+			left.fetch_sub(1, std::memory_order_acq_rel);
+		});
+	}
+
+	// Helps with queued work instead of blocking; rethrows the first exception of a task
+	void wait()
+	{
+		join();
+		std::exception_ptr e;
+		{
+			std::lock_guard lock{error_m};
+			std::swap(e, error);
+		}
+		failed.store(false, std::memory_order_relaxed);
+		if (e) std::rethrow_exception(e);
+	}
+
+private:
+	void join()
+	{
+		while (left.load(std::memory_order_acquire) > 0)
+			if (!pool.run_one()) std::this_thread::yield();
+	}
+
+	Thread_pool& pool;
+	std::atomic<long> left{0};
+	std::atomic<bool> failed{false};
+	std::mutex error_m;
+	std::exception_ptr error;
+};
+
+/*
+	f(begin, end) over [0, n) in chunks of at least grain,
+	about four chunks per thread for load balance.
+*/
+template<typename F>
+void parallel_for(Thread_pool& pool, std::size_t n, std::size_t grain, F f)
+{
+	std::size_t chunks = std::min<std::size_t>(pool.size() * 4,
+		std::max<std::size_t>(1, n / std::max<std::size_t>(1, grain)));
+	if (chunks <= 1) {
+		f(std::size_t{0}, n);
+		return;
+	}
+	Task_group g{pool};
+	for (std::size_t c = 0; c < chunks; ++c) {
+		std::size_t b = n * c / chunks, e = n * (c + 1) / chunks;
+		g.run([&f, b, e] { f(b, e); });
+	}
+	g.wait();
+}
+
+#endif
@@ -1,54 +1,269 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <ranges>
 #include <set>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "NodePool.h"
+
+/*
+	Transparent Comparators
+	-------------------------------------
+	A comparator with a member type is_transparent
+	lets set/map lookups (find, count, lower_bound,
+	equal_range, ..) take any key type the comparator
+	can compare against the element type.
+
+	So we can look up a Person by a std::string_view
+	or a const char* without first building a Person
+	(and the std::string inside it) just to throw it
+	away after the search.
+*/
 
 struct Person {
 	std::string name;
 };
 
-template<typename Type, typename ...Comparator>
-auto make_set(Comparator&& ... Comparator)
+// Inheriting from lambdas: one operator() per overload
+template<typename ...Comparator>
+struct Overloaded_compare : Comparator... {
+	using Comparator::operator()...;
+	using is_transparent = int;
+};
+
+// The allocator is a policy too: make_set<Person, Pool_allocator<Person>>(..)
+template<typename Type, typename Allocator = std::allocator<Type>,
+	typename ...Comparator>
+auto make_set(Comparator&& ... comparator)
 {
-	// Inheriting from lambdas
-	struct Compare: std::decay_t<Comparator>... {
-		using std::decay_t<Comparator>::operator()...;
-		using is_transparent = int;
-	}
+	using Compare = Overloaded_compare<std::decay_t<Comparator>...>;
 
 	// direct init base class of a struct using uniform init
-	return std::set<Type, Compare>{Compare{std::forward<Comparator>(comparator)...}};
+	return std::set<Type, Compare, Allocator>{
+		Compare{std::forward<Comparator>(comparator)...}, Allocator{}};
 }
 
-int main() {
-	
-	auto set = make_set<Person>(
-		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
-		[](const auto &lhs, const Person& rhs){ return lhs < rhs.name; },
-		[](const Person &lhs, const auto &rhs){ return lhs.name < rhs; },
-	);
-
+template<typename Key, typename Value,
+	typename Allocator = std::allocator<std::pair<const Key, Value>>,
+	typename ...Comparator>
+auto make_map(Comparator&& ... comparator)
+{
+	using Compare = Overloaded_compare<std::decay_t<Comparator>...>;
+	return std::map<Key, Value, Compare, Allocator>{
+		Compare{std::forward<Comparator>(comparator)...}, Allocator{}};
 }
 
+/*
+	Building from a range
+	-------------------------------------
+	Inserting one by one costs O(log n) comparisons per
+	element. Insertion with a hint just before the right
+	position is amortized O(1), so input already sorted
+	under the comparator is loaded in linear time by always
+	hinting end(). Unsorted input is sorted once first.
+	Like repeated insert, the first of equal keys wins.
+	Elements are moved out of an rvalue range that owns
+	them (a container); a view, even an rvalue one, only
+	refers to someone else's elements, so they're copied.
+*/
+template<typename Type, typename Allocator = std::allocator<Type>,
+	typename Range, typename ...Comparator>
+auto make_set_from(Range&& range, Comparator&& ... comparator)
+{
+	auto set = make_set<Type, Allocator>(std::forward<Comparator>(comparator)...);
+	auto cmp = set.key_comp();
+	constexpr bool owns = !std::is_lvalue_reference_v<Range>
+		&& !std::ranges::view<std::remove_cvref_t<Range>> && !std::ranges::borrowed_range<Range>;
+	auto take = [](auto& x) -> decltype(auto) {
+		if constexpr (owns) return std::move(x);
+		else return (x);
+	};
 
+	auto b = std::ranges::begin(range);
+	auto e = std::ranges::end(range);
+	if (std::is_sorted(b, e, cmp)) {
+		for (; b != e; ++b)
+			set.emplace_hint(set.end(), take(*b));
+		return set;
+	}
 
+	std::vector<Type> sorted;
+	if constexpr (std::ranges::sized_range<Range>)
+		sorted.reserve(std::ranges::size(range));
+	for (; b != e; ++b)
+		sorted.push_back(take(*b));
+	std::stable_sort(sorted.begin(), sorted.end(), cmp);
+	for (auto& x : sorted)
+		set.emplace_hint(set.end(), std::move(x));
+	return set;
+}
 
+// Counting allocations to see what heterogeneous lookup saves.
+// Every form is replaced, so each delete matches its new.
+static std::size_t allocations = 0;
 
+static void* counted_alloc(std::size_t n, std::size_t align) noexcept
+{
+	++allocations;
+	if (n == 0) n = 1;
+	if (align <= alignof(std::max_align_t)) return std::malloc(n);
+	return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
 
+static void* counted_alloc_or_throw(std::size_t n, std::size_t align)
+{
+	if (void* p = counted_alloc(n, align)) return p;
+	throw std::bad_alloc{};
+}
 
+void* operator new(std::size_t n) { return counted_alloc_or_throw(n, 0); }
+void* operator new[](std::size_t n) { return counted_alloc_or_throw(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, std::size_t(a)); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return counted_alloc(n, 0); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return counted_alloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return counted_alloc(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return counted_alloc(n, std::size_t(a)); }
 
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
 
+template<typename F>
+void measure(const char* label, F f)
+{
+	std::size_t before = allocations;
+	auto t0 = std::chrono::steady_clock::now();
+	std::size_t hits = f();
+	auto t1 = std::chrono::steady_clock::now();
+	std::printf("%-38s %8zu hits %10zu allocations %8.2f ms\n", label, hits,
+		allocations - before,
+		std::chrono::duration<double, std::milli>(t1 - t0).count());
+}
 
+int main(int argc, char* argv[]) {
 
+	auto set = make_set<Person>(
+		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
+		[](const auto &lhs, const Person& rhs){ return lhs < rhs.name; },
+		[](const Person &lhs, const auto &rhs){ return lhs.name < rhs; }
+	);
 
+	for (const char* s : {"Ada Lovelace", "Alan Turing", "Barbara Liskov", "Bjarne Stroustrup"})
+		set.insert(Person{s});
 
+	// None of these builds a Person or a std::string
+	std::cout << set.count("Alan Turing") << " "
+		<< (set.find(std::string_view{"Barbara Liskov"}) != set.end()) << " "
+		<< set.lower_bound("B")->name << "\n";
+	auto [lo, hi] = set.equal_range(std::string_view{"Ada Lovelace"});
+	std::cout << lo->name << " .. " << (hi == set.end() ? "end" : hi->name) << "\n";
 
+	auto ages = make_map<Person, int>(
+		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
+		[](std::string_view lhs, const Person& rhs){ return lhs < rhs.name; },
+		[](const Person &lhs, std::string_view rhs){ return lhs.name < rhs; }
+	);
+	ages.emplace(Person{"Grace Hopper"}, 85);
+	std::cout << ages.find("Grace Hopper")->second << "\n";
 
+	// Same lookups, nodes from a per-set slab pool
+	auto pooled = make_set<Person, Pool_allocator<Person>>(
+		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
+		[](std::string_view lhs, const Person& rhs){ return lhs < rhs.name; },
+		[](const Person &lhs, std::string_view rhs){ return lhs.name < rhs; }
+	);
+	pooled.insert(set.begin(), set.end());
+	std::cout << pooled.count("Alan Turing") << " in "
+		<< pooled.get_allocator().resource().slab_count() << " slab(s)\n";
 
+	/*
+		Lookup benchmark. Names are longer than the
+		small-string buffer, so a temporary Person
+		means a heap allocation per lookup.
+	*/
+	const int n = argc > 1 ? std::atoi(argv[1]) : 200'000;
+	std::vector<std::string> names;
+	names.reserve(n);
+	for (int i = 0; i < n; ++i) {
+		char buf[48];
+		std::snprintf(buf, sizeof buf, "Customer record %09d", i * 7919 % n);
+		names.emplace_back(buf);
+	}
 
+	auto opaque = std::set<Person, bool(*)(const Person&, const Person&)>{
+		[](const Person& lhs, const Person& rhs){ return lhs.name < rhs.name; }};
+	auto transparent = make_set<Person>(
+		[](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; },
+		[](std::string_view lhs, const Person& rhs){ return lhs < rhs.name; },
+		[](const Person &lhs, std::string_view rhs){ return lhs.name < rhs; }
+	);
+	for (auto& s : names) {
+		opaque.insert(Person{s});
+		transparent.insert(Person{s});
+	}
 
+	/*
+		Bulk construction: one-by-one inserts of shuffled
+		records vs loading sorted and unsorted ranges.
+	*/
+	auto by_name = [](const Person &lhs, const Person& rhs){ return lhs.name < rhs.name; };
+	std::vector<Person> people;
+	for (auto& s : names) people.push_back(Person{s});
+	std::vector<Person> sorted_people = people;
+	std::sort(sorted_people.begin(), sorted_people.end(), by_name);
 
+	measure("insert one by one", [&] {
+		auto s = make_set<Person, Pool_allocator<Person>>(by_name);
+		for (auto& p : people) s.insert(p);
+		return s.size();
+	});
+	measure("make_set_from(sorted)", [&] {
+		return make_set_from<Person, Pool_allocator<Person>>(sorted_people, by_name).size();
+	});
+	measure("make_set_from(unsorted)", [&] {
+		return make_set_from<Person, Pool_allocator<Person>>(people, by_name).size();
+	});
 
-
-
-
-
-
+	measure("find(Person{const char*})", [&] {
+		std::size_t hits = 0;
+		for (auto& s : names) hits += opaque.find(Person{s.c_str()}) != opaque.end();
+		return hits;
+	});
+	measure("find(const char*) transparent", [&] {
+		std::size_t hits = 0;
+		for (auto& s : names) hits += transparent.find(s.c_str()) != transparent.end();
+		return hits;
+	});
+	measure("count(string_view) transparent", [&] {
+		std::size_t hits = 0;
+		for (auto& s : names) hits += transparent.count(std::string_view{s});
+		return hits;
+	});
+	measure("equal_range(string_view) transparent", [&] {
+		std::size_t hits = 0;
+		for (auto& s : names) {
+			auto [b, e] = transparent.equal_range(std::string_view{s});
+			hits += b != e;
+		}
+		return hits;
+	});
+}
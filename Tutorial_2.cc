@@ -69,9 +69,9 @@
 double add_all(double* array, int n)
 {
 	double s{0};
-	for (int i = 0; i < n; i++
+	for (int i = 0; i < n; i++)
 		s = s + array[i];
-	retrun s;
+	return s;
 }
 
 // Accumulate on linked list
@@ -83,10 +83,10 @@ struct Node {
 int sum_elem(Node* first, Node* last)
 {
 	int s = 0;
-	while (first != last)
-		s = first->data;
+	while (first != last) {
+		s += first->data;
 		first = first->next;
-
+	}
 	return s;
 }
 
@@ -95,10 +95,10 @@ template<typename Iter, typename Val>
 Val sum(Iter first, Iter last)
 {
 	Val s = 0;
-	while (first != last)
+	while (first != last) {
 		s = s + *first;
 		++first;
-	
+	}
 	return s;
 }
 double a[] = {1, 2, 3, 4};
@@ -118,9 +118,10 @@ void test(Node* lst)
 template<typename Iter, typename Val>
 Val accumulate(Iter first, Iter last, Val s)
 {
-	while (first != last)
+	while (first != last) {
 		s = s + *first;
 		++first;
+	}
 	return s;
 }
 
@@ -131,13 +132,20 @@ double sum = accumulate<double*>(a, a+4, 0.0);
 template<typename Iter,typename Val, typename Oper>
 Val accumulate(Iter first, Iter last, Val s, Oper op)
 {
-	while (first != last)
+	while (first != last) {
 		s = op( s,  *first);
 		++first;
-	
+	}
 	return s;
 }
 
+/*
+	Each of these loops is one dependency chain: every
+	addition waits for the one before it. Accumulate.cc
+	has versions for contiguous ranges that keep several
+	independent accumulators in SIMD registers.
+*/
+
 double a[] = {1, 2, 3, 4};
 double sum = accumulate<double*>(a, a+4, 0.0, std::multiply<double>);
 